@@ -0,0 +1,120 @@
+#include "Bench.h"
+#include "Partition.h"
+
+#include <cxxopts.hpp>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+namespace Pivot {
+	BenchRunner::BenchRunner(BenchOptions const &options, std::ostream &out) :
+		m_Options { options },
+		m_Out { out } {
+	}
+
+	void BenchRunner::Run(std::string_view kernel, int size, double items, std::function<void()> const &prepare, std::function<void()> const &run, double bytes) {
+		using Clock = std::chrono::steady_clock;
+		for (auto const threads : m_Options.Threads) {
+			Scheduler::Initialize({ .NumThreads = threads, .Pinned = m_Options.Pinned });
+			std::vector<double> times;
+			double elapsed = 0;
+			Scheduler::Execute([&] {
+				// Warm up caches and the thread pool
+				prepare();
+				run();
+
+				while (static_cast<int>(times.size()) < m_Options.MaxReps &&
+					(static_cast<int>(times.size()) < m_Options.MinReps || elapsed < m_Options.MinTime)) {
+					prepare();
+					auto const beginTime = Clock::now();
+					run();
+					times.push_back(std::chrono::duration<double>(Clock::now() - beginTime).count());
+					elapsed += times.back();
+				}
+			});
+			std::sort(times.begin(), times.end());
+			double const mean = elapsed / times.size();
+			double var = 0;
+			for (auto const t : times) var += (t - mean) * (t - mean);
+			double const stddev = std::sqrt(var / times.size());
+			double const median = times[times.size() / 2];
+
+			m_Out << fmt::format(
+				R"({{"kernel":"{}","size":{},"threads":{},"reps":{},"mean":{:.6e},"median":{:.6e},"min":{:.6e},"max":{:.6e},"stddev":{:.6e},"items_per_sec":{:.6e},"est_bytes":{:.6e},"est_bytes_per_sec":{:.6e}}})",
+				kernel, size, threads, times.size(), mean, median, times.front(), times.back(), stddev, items / median, bytes, bytes / median) << std::endl;
+			spdlog::info("{:<24} size = {:>6}, threads = {:>3}: median = {:.3e}s", kernel, size, threads, median);
+		}
+	}
+}
+
+static std::vector<int> DefaultThreads() {
+	std::vector<int> threads;
+	int const maxThreads = static_cast<int>(std::thread::hardware_concurrency());
+	for (int n = 1; n < maxThreads; n *= 2) threads.push_back(n);
+	threads.push_back(std::max(maxThreads, 1));
+	return threads;
+}
+
+static auto ParseArgs(int argc, char **argv) {
+	try {
+		cxxopts::Options argParser("bench", "Benchmarks of the ferrofluid solver kernels");
+		argParser.add_options()
+			("o,output"   , "JSON lines output file"      , cxxopts::value<std::string>()->default_value(""))
+			("k,kernels"  , "Substring of kernels to run" , cxxopts::value<std::string>()->default_value(""))
+			("s,sizes"    , "Grid resolutions"            , cxxopts::value<std::vector<int>>()->default_value("128,256,512,1024,2048,4096"))
+			("m,mag-sizes", "Magnetic boundary sizes"     , cxxopts::value<std::vector<int>>()->default_value("1000,2000,5000,10000"))
+			("scene-sizes", "Scene resolutions"           , cxxopts::value<std::vector<int>>()->default_value("128,256,512"))
+			("scene-steps", "Substeps per scene run"      , cxxopts::value<int>()->default_value("10"))
+			("t,threads"  , "Thread counts"               , cxxopts::value<std::vector<int>>())
+			("min-reps"   , "Minimum repetitions"         , cxxopts::value<int>()->default_value("3"))
+			("max-reps"   , "Maximum repetitions"         , cxxopts::value<int>()->default_value("100"))
+			("min-time"   , "Minimum seconds per config"  , cxxopts::value<double>()->default_value(".5"))
+			("pin"        , "Pin worker threads to cores")
+			("grains"     , "Grain cache file"            , cxxopts::value<std::string>()->default_value(""))
+			("tune"       , "Tune the missing grain cache entries")
+			("h,help"     , "Print usage");
+		auto result = argParser.parse(argc, argv);
+		if (result.count("help")) {
+			std::cout << argParser.help() << std::endl;
+			std::exit(EXIT_SUCCESS);
+		}
+		Pivot::BenchOptions options = {
+			.Sizes         = result["sizes"].as<std::vector<int>>(),
+			.MagneticSizes = result["mag-sizes"].as<std::vector<int>>(),
+			.SceneSizes    = result["scene-sizes"].as<std::vector<int>>(),
+			.Threads       = result.count("threads") ? result["threads"].as<std::vector<int>>() : DefaultThreads(),
+			.Filter        = result["kernels"].as<std::string>(),
+			.MinReps       = result["min-reps"].as<int>(),
+			.MaxReps       = result["max-reps"].as<int>(),
+			.MinTime       = result["min-time"].as<double>(),
+			.SceneSteps    = result["scene-steps"].as<int>(),
+			.Pinned        = result.count("pin") > 0,
+		};
+		auto const grains = result["grains"].as<std::string>();
+		if (!grains.empty()) {
+			Pivot::GrainTuner::Configure(result.count("tune") ? Pivot::GrainTuner::Mode::Tune : Pivot::GrainTuner::Mode::Cached, grains);
+		}
+		return std::pair(options, result["output"].as<std::string>());
+	} catch (cxxopts::exceptions::exception const &e) {
+		spdlog::critical("Failed to parse command line: {}", e.what());
+		std::exit(EXIT_FAILURE);
+	}
+}
+
+int main(int argc, char **argv) {
+	// Initialize logger, keeping stdout for the results
+	spdlog::set_default_logger(spdlog::stderr_color_mt("bench"));
+	spdlog::set_pattern("[%T] %^[%l]%$ %v");
+	spdlog::set_level(spdlog::level::info);
+	// Main process
+	auto [options, output] = ParseArgs(argc, argv);
+	std::ofstream file;
+	if (!output.empty()) {
+		file.open(output, std::ios::trunc);
+	}
+	Pivot::BenchRunner runner(options, output.empty() ? std::cout : file);
+	Pivot::RunKernelBenchmarks(runner);
+	Pivot::RunMagneticBenchmarks(runner);
+	Pivot::RunSceneBenchmarks(runner);
+	Pivot::GrainTuner::Save();
+
+	return EXIT_SUCCESS;
+}
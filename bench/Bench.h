@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Scheduler.h"
+
+namespace Pivot {
+	struct BenchOptions {
+		std::vector<int> Sizes;          // grid resolutions of the kernel benchmarks
+		std::vector<int> MagneticSizes;  // boundary vertex counts of the magnetic benchmarks
+		std::vector<int> SceneSizes;     // grid resolutions of the end-to-end benchmarks
+		std::vector<int> Threads;
+		std::string      Filter;         // substring of the kernel names to run, empty for all
+		int              MinReps = 3;
+		int              MaxReps = 100;
+		double           MinTime = .5;   // seconds spent per configuration before stopping
+		int              SceneSteps = 10;
+		bool             Pinned = false;  // pin worker threads to cores
+	};
+
+	// Times kernels over a thread-count sweep and reports every configuration as one JSON line.
+	class BenchRunner {
+	public:
+		BenchRunner(BenchOptions const &options, std::ostream &out);
+
+		BenchOptions const &GetOptions() const { return m_Options; }
+
+		bool IsSelected(std::string_view kernel) const { return kernel.find(m_Options.Filter) != std::string_view::npos; }
+
+		// Calls prepare (untimed) and run (timed) repeatedly for every thread count. Items is the number of
+		// elements processed per run, reported as throughput, and bytes the estimated memory traffic per run,
+		// reported as est_bytes.
+		void Run(std::string_view kernel, int size, double items, std::function<void()> const &prepare, std::function<void()> const &run, double bytes = 0);
+
+	private:
+		BenchOptions  m_Options;
+		std::ostream &m_Out;
+	};
+
+	void RunKernelBenchmarks(BenchRunner &runner);
+	void RunMagneticBenchmarks(BenchRunner &runner);
+	void RunSceneBenchmarks(BenchRunner &runner);
+}
@@ -0,0 +1,265 @@
+#include "Bench.h"
+
+#include "Advection.h"
+#include "CSG.h"
+#include "Contour.h"
+#include "Extrapolation.h"
+#include "Magnetic.h"
+#include "Pressure.h"
+#include "Reinitialization.h"
+#include "SimBuilder.h"
+
+namespace Pivot {
+	// A wavy disk in a unit box, rotating rigidly at one cell per unit time at the rim
+	struct SyntheticScene {
+		StaggeredGrid     SGrid;
+		GridData<double>  LevelSet;
+		SGridData<double> Velocity;
+		double            DeltaTime;
+
+		explicit SyntheticScene(int size) :
+			SGrid(2, 1. / size, Vector2i::Constant(size)),
+			LevelSet(SGrid.GetCellGrid()),
+			Velocity(SGrid.GetFaceGrids()),
+			DeltaTime { SGrid.GetSpacing() / .5 } {
+			ParallelForEach(LevelSet.GetGrid(), [&](Vector2i const &cell) {
+				Vector2d const pos = LevelSet.GetGrid().PositionOf(cell);
+				double const theta = std::atan2(pos.y(), pos.x());
+				LevelSet[cell] = pos.norm() - .3 * (1 + .05 * std::sin(8 * theta));
+			});
+			Reinitialization::Solve(LevelSet, 5);
+			ParallelForEach(Velocity.GetGrids(), [&](int axis, Vector2i const &face) {
+				Vector2d const pos = Velocity[axis].GetGrid().PositionOf(face);
+				Velocity[axis][face] = axis == 0 ? -pos.y() : pos.x();
+			});
+		}
+	};
+
+	// Estimated bytes streamed by the face passes of one substep, counted from the fields each pass touches:
+	// advecting the velocity reads it and writes the new one, building the active set reads the level set and
+	// face fractions and writes the face mask, applying the projection updates the fluid faces only, and the
+	// extrapolation clears the faces outside the mask. The iterations of the pressure solve, the extrapolation
+	// band and the stencils of the solid faces depend on the scene and are not counted, so the figure is a
+	// lower bound reported as est_bytes.
+	static double FacePassBytes(SGridData<double> const &velocity, GridData<double> const &levelSet, Collider const &collider, ActiveSet const &active) {
+		double field = 0;
+		double mask = 0;
+		double fraction = 0;
+		for (int axis = 0; axis < 2; axis++) {
+			field += velocity[axis].GetData().size() * sizeof(double);
+			mask += active.GetFluidFaceMask()[axis].GetData().size() * sizeof(std::uint8_t);
+			fraction += collider.GetFraction()[axis].GetData().size() * sizeof(double);
+		}
+		double const numFluidFaces = active.GetFluidFaces(0).size() + active.GetFluidFaces(1).size();
+		// Face index, fraction, velocity read and written, and the unknown ids and pressures of both cells
+		double const perFluidFace = sizeof(int) + sizeof(double) + 2 * sizeof(double) + 2 * (sizeof(int) + sizeof(double));
+		double const advect = 2 * field;
+		double const build = levelSet.GetData().size() * sizeof(double) + fraction + mask;
+		double const extrapolate = mask + field;
+		return advect + build + numFluidFaces * perFluidFace + extrapolate;
+	}
+
+	static constexpr int c_NumDistanceQueries = 1 << 16;
+
+	void RunKernelBenchmarks(BenchRunner &runner) {
+		for (auto const size : runner.GetOptions().Sizes) {
+			SyntheticScene scene(size);
+			auto const &sgrid = scene.SGrid;
+			double const numCells = sgrid.GetNumCells();
+
+			GridData<double>  levelSet(scene.LevelSet);
+			SGridData<double> velocity(scene.Velocity);
+			auto const restore = [&] {
+				levelSet = scene.LevelSet;
+				velocity = scene.Velocity;
+			};
+
+			if (runner.IsSelected("advection.levelset")) {
+				runner.Run("advection.levelset", size, numCells, restore, [&] { Advection::Solve<2>(levelSet, scene.Velocity, scene.DeltaTime); });
+			}
+			if (runner.IsSelected("advection.velocity")) {
+				runner.Run("advection.velocity", size, numCells, restore, [&] { Advection::Solve<2>(velocity, scene.Velocity, scene.DeltaTime); });
+			}
+			if (runner.IsSelected("advection.levelset.maccormack")) {
+				runner.Run("advection.levelset.maccormack", size, numCells, restore, [&] { Advection::Solve<2>(levelSet, scene.Velocity, scene.DeltaTime, Advection::Scheme::MacCormack); });
+			}
+			if (runner.IsSelected("advection.levelset.bfecc")) {
+				runner.Run("advection.levelset.bfecc", size, numCells, restore, [&] { Advection::Solve<2>(levelSet, scene.Velocity, scene.DeltaTime, Advection::Scheme::BFECC); });
+			}
+			if (runner.IsSelected("advection.velocity.maccormack")) {
+				runner.Run("advection.velocity.maccormack", size, numCells, restore, [&] { Advection::Solve<2>(velocity, scene.Velocity, scene.DeltaTime, Vector2d(0, 0), Advection::Scheme::MacCormack); });
+			}
+			if (runner.IsSelected("advection.velocity.bfecc")) {
+				runner.Run("advection.velocity.bfecc", size, numCells, restore, [&] { Advection::Solve<2>(velocity, scene.Velocity, scene.DeltaTime, Vector2d(0, 0), Advection::Scheme::BFECC); });
+			}
+			if (runner.IsSelected("reinitialization")) {
+				runner.Run("reinitialization", size, numCells, restore, [&] { Reinitialization::Solve(levelSet, 5); });
+			}
+			if (runner.IsSelected("reinitialization.geometric")) {
+				// Including the contour it takes the distances to
+				Contour contour(sgrid.GetCellGrid());
+				runner.Run("reinitialization.geometric", size, numCells, restore, [&] {
+					contour.Generate(levelSet);
+					Reinitialization::Solve(levelSet, 5, contour.GetMesh());
+				});
+			}
+			if (runner.IsSelected("collider.build")) {
+				// The domain walls and a row of obstacles, as a scene builds them at startup
+				runner.Run("collider.build", size, numCells, [] { }, [&] {
+					Collider collider(sgrid);
+					for (int i = -2; i <= 2; i++) {
+						CSG::Union(collider.LevelSet, ImplicitSphere(Vector2d(i * .2, -.3), .06));
+					}
+					collider.Finish();
+				});
+			}
+			if (runner.IsSelected("collider.move")) {
+				// A stirring rod turning about the center by about a cell at its tips per substep
+				Collider collider(sgrid);
+				collider.AddBody({
+					.Shape = std::make_unique<ImplicitBox>(Vector2d(-.25, -.02), Vector2d(.5, .04)),
+					.Pivot = Vector2d::Zero(),
+					.BoundsMin = Vector2d(-.25, -.02),
+					.BoundsMax = Vector2d(.25, .02),
+					.AngularVelocity = 1. / (.25 * size * scene.DeltaTime),
+				});
+				collider.Finish();
+				double time = 0;
+				runner.Run("collider.move", size, numCells, [] { }, [&] { collider.MoveBodies(time += scene.DeltaTime); });
+			}
+			if (runner.IsSelected("extrapolation")) {
+				runner.Run("extrapolation", size, numCells, restore, [&] {
+					Extrapolation::Solve(velocity, 0., 6, [&](int axis, Vector2i const &face) {
+						Vector2i const cell0 = StaggeredGrid::AdjCellOfFace(axis, face, 0);
+						Vector2i const cell1 = StaggeredGrid::AdjCellOfFace(axis, face, 1);
+						return levelSet.At(cell0) <= 0 || levelSet.At(cell1) <= 0;
+					});
+				});
+			}
+
+			Contour contour(sgrid.GetCellGrid());
+			if (runner.IsSelected("contour.generate")) {
+				runner.Run("contour.generate", size, numCells, [] { }, [&] { contour.Generate(scene.LevelSet); });
+			}
+			contour.Generate(scene.LevelSet);
+			if (runner.IsSelected("contour.vertex_infos")) {
+				runner.Run("contour.vertex_infos", size, numCells, [] { }, [&] { contour.ComputeVertexInfosFromLS(scene.LevelSet); });
+			}
+			if (runner.IsSelected("contour.volume")) {
+				runner.Run("contour.volume", size, numCells, [] { }, [&] { contour.ComputeVolumeFromLS(scene.LevelSet); });
+			}
+			if (runner.IsSelected("contour.query_grid")) {
+				runner.Run("contour.query_grid", size, contour.GetMesh().Indices.size() / 2, [] { }, [&] { contour.GetMesh().BuildQueryGrid(); });
+			}
+			if (runner.IsSelected("contour.distance")) {
+				// The same queries in a band around the interface at every size, so that only the contour grows
+				std::vector<Vector2d> positions(c_NumDistanceQueries);
+				for (int i = 0; i < c_NumDistanceQueries; i++) {
+					double const theta = 2 * std::numbers::pi * i / std::numbers::phi;
+					double const radius = .25 + .1 * (i % 256) / 256.;
+					positions[i] = radius * Vector2d(std::cos(theta), std::sin(theta));
+				}
+				std::vector<double> distances(c_NumDistanceQueries);
+				runner.Run("contour.distance", size, c_NumDistanceQueries, [] { }, [&] { contour.GetMesh().SignedDistancesTo(positions, distances); });
+			}
+
+			if (runner.IsSelected("pressure.project")) {
+				Collider collider(sgrid);
+				collider.Finish();
+				Pressure pressure(sgrid);
+				ActiveSet active(sgrid);
+				active.Build(scene.LevelSet, collider);
+				runner.Run("pressure.project", size, numCells, restore, [&] { pressure.Project(velocity, scene.LevelSet, collider, active); });
+			}
+			if (runner.IsSelected("substep.faces")) {
+				// The velocity passes of Simulation::Advance, including the pressure solve
+				Collider collider(sgrid);
+				collider.Finish();
+				Pressure pressure(sgrid);
+				ActiveSet active(sgrid);
+				runner.Run("substep.faces", size, numCells, restore, [&] {
+					Advection::Solve<2>(velocity, velocity, scene.DeltaTime, Vector2d(0, -9.8 * scene.DeltaTime));
+					active.Build(scene.LevelSet, collider);
+					pressure.Project(velocity, scene.LevelSet, collider, active);
+					Extrapolation::Solve(velocity, 0., 6, active.GetFluidFaceMask(), { active.GetFluidFaces(0), active.GetFluidFaces(1) });
+					collider.Enforce(velocity);
+				}, [&] {
+					active.Build(scene.LevelSet, collider);
+					return FacePassBytes(velocity, scene.LevelSet, collider, active);
+				}());
+			}
+		}
+	}
+
+	void RunMagneticBenchmarks(BenchRunner &runner) {
+		if (!runner.IsSelected("magnetic.solve") && !runner.IsSelected("magnetic.mc") && !runner.IsSelected("magnetic.mc.reuse") && !runner.IsSelected("magnetic.panel") && !runner.IsSelected("magnetic.resampled")) return;
+		for (auto const size : runner.GetOptions().MagneticSizes) {
+			// A circle of radius 1cm, comparable to the ferrofluid in the box scene
+			SurfaceMesh mesh;
+			double const radius = .01;
+			for (int i = 0; i < size; i++) {
+				double const theta = 2 * std::numbers::pi * i / size;
+				Vector2d const normal(std::cos(theta), std::sin(theta));
+				mesh.Positions.push_back(normal * radius);
+				mesh.Normals.push_back(normal);
+				mesh.Indices.push_back(i);
+				mesh.Indices.push_back((i + 1) % size);
+			}
+			mesh.Components.push_back({ 0, static_cast<std::uint32_t>(size), true });
+			mesh.ComputeAreas();
+			if (runner.IsSelected("magnetic.solve")) {
+				Magnetic magnetic;
+				runner.Run("magnetic.solve", size, size, [] { }, [&] { magnetic.Solve(mesh); });
+			}
+			if (runner.IsSelected("magnetic.mc")) {
+				// Fewer walks per vertex than a solve would take, as only their cost is measured
+				Magnetic magnetic;
+				magnetic.SetMethod(Magnetic::Method::MC);
+				magnetic.SetNumSamples(256);
+				runner.Run("magnetic.mc", size, size, [] { }, [&] { magnetic.Solve(mesh); });
+			}
+			if (runner.IsSelected("magnetic.mc.reuse")) {
+				Magnetic magnetic;
+				magnetic.SetMethod(Magnetic::Method::MC);
+				magnetic.SetNumSamples(256);
+				magnetic.SetReuseWalks(true);
+				runner.Run("magnetic.mc.reuse", size, size, [] { }, [&] { magnetic.Solve(mesh); });
+			}
+			if (runner.IsSelected("magnetic.panel")) {
+				Magnetic magnetic;
+				magnetic.SetMethod(Magnetic::Method::Panel);
+				runner.Run("magnetic.panel", size, size, [] { }, [&] { magnetic.Solve(mesh); });
+			}
+			if (runner.IsSelected("magnetic.resampled")) {
+				// About a hundred panels whatever the size
+				Magnetic magnetic;
+				magnetic.SetMethod(Magnetic::Method::Panel);
+				magnetic.SetResampling(1e-3, .2);
+				runner.Run("magnetic.resampled", size, size, [] { }, [&] { magnetic.Solve(mesh); });
+			}
+		}
+	}
+
+	void RunSceneBenchmarks(BenchRunner &runner) {
+		// Long thin interfaces load the magnetic solve, large areas the pressure solve
+		for (auto const name : { "box", "falling", "bigball", "slope", "droplet" }) {
+			auto const kernel = fmt::format("scene.{}", name);
+			if (!runner.IsSelected(kernel)) continue;
+			for (auto const size : runner.GetOptions().SceneSizes) {
+				std::unique_ptr<Simulation> simulation;
+				int const steps = runner.GetOptions().SceneSteps;
+				// Every run starts from the freshly initialized scene
+				auto const prepare = [&] {
+					simulation = SimBuilder::Build({ .Scene = ParseSceneName(name), .Scale = size });
+					simulation->Initialize();
+				};
+				auto const run = [&] {
+					for (int i = 0; i < steps; i++) {
+						simulation->Advance(std::min(1. / 50, simulation->GetCourantTimeStep()));
+					}
+				};
+				runner.Run(kernel, size, steps, prepare, run);
+			}
+		}
+	}
+}
@@ -0,0 +1,28 @@
+#include "ActiveSet.h"
+
+namespace Pivot {
+	ActiveSet::ActiveSet(StaggeredGrid const &sgrid) :
+		m_FluidFaceMask(sgrid.GetFaceGrids()) {
+	}
+
+	void ActiveSet::Build(GridData<double> const &levelSet, Collider const &collider) {
+		Grid const &grid = levelSet.GetGrid();
+		m_FluidCells = ParallelFilter(grid.GetNumVertices(), [&](int index) { return levelSet[index] <= 0; });
+		m_InterfaceCells = ParallelFilter(grid.GetNumVertices(), [&](int index) {
+			Vector2i const coord = grid.CoordOf(index);
+			for (int i = 0; i < Grid::GetNumNeighbors(); i++) {
+				Vector2i const nbCoord = Grid::NeighborOf(coord, i);
+				if (grid.IsValid(nbCoord) && levelSet[coord] * levelSet[nbCoord] <= 0) return true;
+			}
+			return false;
+		});
+		ParallelForEach(m_FluidFaceMask.GetGrids(), [&](int axis, Vector2i const &face) {
+			// Fully solid faces include the domain boundary, so both adjacent cells exist otherwise
+			m_FluidFaceMask[axis][face] = collider.GetFraction()[axis][face] < 1
+				&& (levelSet[StaggeredGrid::AdjCellOfFace(axis, face, 0)] <= 0 || levelSet[StaggeredGrid::AdjCellOfFace(axis, face, 1)] <= 0);
+		}, { .Kind = Partitioner::Static, .Grain = 1024 });
+		for (int axis = 0; axis < 2; axis++) {
+			m_FluidFaces[axis] = ParallelFilter(m_FluidFaceMask[axis].GetGrid().GetNumVertices(), [&](int index) { return m_FluidFaceMask[axis][index] != 0; });
+		}
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Collider.h"
+
+namespace Pivot {
+	// Compact index lists of the cells and faces a substep works on, so that kernels scale with the liquid
+	// rather than with the domain. Fully solid faces are listed by the Collider.
+	class ActiveSet {
+	public:
+		explicit ActiveSet(StaggeredGrid const &sgrid);
+
+		// Rebuilds every list from the level set in one parallel pass over cells and faces.
+		void Build(GridData<double> const &levelSet, Collider const &collider);
+
+		std::vector<int>        const &GetFluidCells    ()         const { return m_FluidCells; }
+		std::vector<int>        const &GetInterfaceCells()         const { return m_InterfaceCells; }
+		std::vector<int>        const &GetFluidFaces    (int axis) const { return m_FluidFaces[axis]; }
+		SGridData<std::uint8_t> const &GetFluidFaceMask ()         const { return m_FluidFaceMask; }
+
+	private:
+		std::vector<int>                m_FluidCells;     // level set <= 0, in index order
+		std::vector<int>                m_InterfaceCells; // the level set changes sign to a neighbor, in index order
+		std::array<std::vector<int>, 2> m_FluidFaces;     // not fully solid and next to a fluid cell
+		SGridData<std::uint8_t>         m_FluidFaceMask;
+	};
+}
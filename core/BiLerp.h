@@ -1,6 +1,6 @@
 #pragma once
 
-#include "GridData.h"
+#include "SGridData.h"
 
 namespace Pivot {
 	class BiLerp {
@@ -2,7 +2,6 @@
 
 #include "BiLerp.h"
 #include "FiniteDiff.h"
-#include "Reinitialization.h"
 
 namespace Pivot {
 	Collider::Collider(StaggeredGrid const &sgrid) :
@@ -18,35 +17,221 @@ namespace Pivot {
 		});
 	}
 
-	void Collider::Finish(StaggeredGrid const &sgrid) {
-		Reinitialization::Solve(LevelSet, -1);
+	// Visits the vertices of the box [lower, upper) clipped to the grid.
+	template <typename Func>
+	static void ParallelForEachIn(Grid const &grid, Vector2i lower, Vector2i upper, Func &&func) {
+		lower = lower.cwiseMax(0);
+		upper = upper.cwiseMin(grid.GetSize());
+		if ((lower.array() >= upper.array()).any()) return;
+		tbb::parallel_for(lower.x(), upper.x(), [&](int i) {
+			for (int j = lower.y(); j < upper.y(); j++) {
+				func(Vector2i(i, j));
+			}
+		});
+	}
+
+	void Collider::AddBody(Body body) {
+		m_Bodies.push_back(std::move(body));
+	}
+
+	void Collider::Finish() {
+		// The primitives give exact distances away from their CSG creases, so the level set is only clamped to the
+		// band, as UpdateRegion does for the moving bodies
+		double const bandWidth = GetBandWidth();
+		ParallelForEach(LevelSet.GetGrid(), [&](Vector2i const &node) {
+			LevelSet[node] = std::clamp(LevelSet[node], -bandWidth, bandWidth);
+		}, { .Kind = Partitioner::Static, .Grain = 1024 });
 		ParallelForEach(m_AuxLevelSet.GetGrid(), [&](Vector2i const &cell) {
 			for (int i = 0; i < StaggeredGrid::GetNumNodesPerCell(); i++) {
 				m_AuxLevelSet[cell] += LevelSet[StaggeredGrid::NodeOfCell(cell, i)];
 			}
 			m_AuxLevelSet[cell] /= StaggeredGrid::GetNumNodesPerCell();
 		});
-		auto levelSetDrvs = std::to_array({ GridData<double>(sgrid.GetNodeGrid()), GridData<double>(sgrid.GetNodeGrid()) });
-		tbb::parallel_for(0, 2, [&](int axis) {
-			ParallelForEach(sgrid.GetNodeGrid(), [&](Vector2i const &node) {
-				levelSetDrvs[axis][node] = FiniteDiff::CalcFirstDrv(LevelSet, node, axis);
+		ParallelForEach(m_Fraction.GetGrids(), [&](int axis, Vector2i const &face) {
+			UpdateFace(axis, face);
+		});
+		if (HasBodies()) {
+			m_StaticLevelSet.emplace(LevelSet);
+			m_EnforcedFaceSlots.emplace(m_Fraction.GetGrids(), Vector2i::Constant(-1));
+		}
+		BuildEnforcedFaces();
+		for (auto const &body : m_Bodies) {
+			auto const [lower, upper] = CalcBodyRegion(body, m_BodyTime);
+			UpdateRegion(lower, upper);
+		}
+	}
+
+	void Collider::MoveBodies(double time) {
+		if (time == m_BodyTime) return;
+		std::vector<std::pair<Vector2i, Vector2i>> regions;
+		for (auto const &body : m_Bodies) {
+			regions.push_back(CalcBodyRegion(body, m_BodyTime));
+		}
+		m_BodyTime = time;
+		for (std::size_t i = 0; i < m_Bodies.size(); i++) {
+			// The box swept from the old place to the new one
+			auto const [lower, upper] = CalcBodyRegion(m_Bodies[i], m_BodyTime);
+			UpdateRegion(regions[i].first.cwiseMin(lower), regions[i].second.cwiseMax(upper));
+		}
+	}
+
+	double Collider::GetMaxBodySpeed() const {
+		double maxSpeed = 0;
+		for (auto const &body : m_Bodies) {
+			// The farthest point of the shape from the pivot is within a corner of its bounds
+			double const radius = (body.BoundsMin - body.Pivot).cwiseAbs().cwiseMax((body.BoundsMax - body.Pivot).cwiseAbs()).norm();
+			maxSpeed = std::max(maxSpeed, body.LinearVelocity.norm() + std::abs(body.AngularVelocity) * radius);
+		}
+		return maxSpeed;
+	}
+
+	double Collider::BodyDistanceTo(Body const &body, Vector2d const &pos) const {
+		Vector2d const local = Eigen::Rotation2Dd(-body.AngularVelocity * m_BodyTime) * (pos - BodyCenterOf(body, m_BodyTime)) + body.Pivot;
+		return body.Shape->SignedDistanceTo(local);
+	}
+
+	Vector2d Collider::BodyVelocityAt(Body const &body, Vector2d const &pos) const {
+		Vector2d const arm = pos - BodyCenterOf(body, m_BodyTime);
+		return body.LinearVelocity + body.AngularVelocity * Vector2d(-arm.y(), arm.x());
+	}
+
+	std::pair<Vector2i, Vector2i> Collider::CalcBodyRegion(Body const &body, double time) const {
+		Grid const &grid = LevelSet.GetGrid();
+		Eigen::Rotation2Dd const rotation(body.AngularVelocity * time);
+		Vector2d lower = Vector2d::Constant(std::numeric_limits<double>::infinity());
+		Vector2d upper = -lower;
+		for (int i = 0; i < 4; i++) {
+			Vector2d const corner(i & 1 ? body.BoundsMax.x() : body.BoundsMin.x(), i & 2 ? body.BoundsMax.y() : body.BoundsMin.y());
+			Vector2d const pos = rotation * (corner - body.Pivot) + BodyCenterOf(body, time);
+			lower = lower.cwiseMin(pos);
+			upper = upper.cwiseMax(pos);
+		}
+		Vector2d const margin = Vector2d::Constant(GetBandWidth() + grid.GetSpacing());
+		return { grid.CalcLower<1>(lower - margin), grid.CalcLower<1>(upper + margin) + Vector2i::Constant(2) };
+	}
+
+	void Collider::UpdateFace(int axis, Vector2i const &face) {
+		m_Fraction[axis][face] = CalcFaceFraction(axis, face);
+		m_Normal[axis][face] = 0;
+		bool nearBoundary = false;
+		for (int i = 0; i < StaggeredGrid::GetNumNodesPerFace(); i++) {
+			nearBoundary |= std::abs(LevelSet[StaggeredGrid::NodeOfFace(axis, face, i)]) < GetBandWidth();
+		}
+		if (!nearBoundary) return;
+		double sum = 0;
+		for (int i = 0; i < StaggeredGrid::GetNumNodesPerFace(); i++) {
+			sum += FiniteDiff::CalcFirstDrv(LevelSet, StaggeredGrid::NodeOfFace(axis, face, i), axis);
+		}
+		m_Normal[axis][face] = sum / StaggeredGrid::GetNumNodesPerFace();
+	}
+
+	void Collider::UpdateRegion(Vector2i const &lower, Vector2i const &upper) {
+		double const bandWidth = GetBandWidth();
+		ParallelForEachIn(LevelSet.GetGrid(), lower, upper, [&](Vector2i const &node) {
+			Vector2d const pos = LevelSet.GetGrid().PositionOf(node);
+			double phi = (*m_StaticLevelSet)[node];
+			for (auto const &body : m_Bodies) {
+				phi = std::min(phi, BodyDistanceTo(body, pos));
+			}
+			LevelSet[node] = std::clamp(phi, -bandWidth, bandWidth);
+		});
+		// Cells, faces and enforced faces reach one, two and three nodes farther
+		ParallelForEachIn(m_AuxLevelSet.GetGrid(), lower - Vector2i::Ones(), upper, [&](Vector2i const &cell) {
+			m_AuxLevelSet[cell] = 0;
+			for (int i = 0; i < StaggeredGrid::GetNumNodesPerCell(); i++) {
+				m_AuxLevelSet[cell] += LevelSet[StaggeredGrid::NodeOfCell(cell, i)];
+			}
+			m_AuxLevelSet[cell] /= StaggeredGrid::GetNumNodesPerCell();
+		});
+		for (int axis = 0; axis < 2; axis++) {
+			ParallelForEachIn(m_Fraction[axis].GetGrid(), lower - Vector2i::Constant(2), upper + Vector2i::Constant(2), [&](Vector2i const &face) {
+				UpdateFace(axis, face);
+				// A face belongs to the nearest body if it lies in the band of that body and out of the static solid
+				Vector2d const pos = m_Fraction[axis].GetGrid().PositionOf(face);
+				double staticPhi = 0;
+				for (int i = 0; i < StaggeredGrid::GetNumNodesPerFace(); i++) {
+					staticPhi += (*m_StaticLevelSet)[StaggeredGrid::NodeOfFace(axis, face, i)] / StaggeredGrid::GetNumNodesPerFace();
+				}
+				Body const *owner = nullptr;
+				double minPhi = std::min(staticPhi, bandWidth);
+				for (auto const &body : m_Bodies) {
+					if (double const phi = BodyDistanceTo(body, pos); phi < minPhi) {
+						minPhi = phi;
+						owner = &body;
+					}
+				}
+				Velocity[axis][face] = owner ? BodyVelocityAt(*owner, pos)[axis] : 0;
 			});
+		}
+
+		auto &slots = *m_EnforcedFaceSlots;
+		std::vector<int> dirtySlots;
+		for (int pass = 0; pass < 2; pass++) {
+			for (int axis = 0; axis < 2; axis++) {
+				Grid const &grid = m_Fraction[axis].GetGrid();
+				Vector2i const faceLower = (lower - Vector2i::Constant(3)).cwiseMax(0);
+				Vector2i const faceUpper = (upper + Vector2i::Constant(3)).cwiseMin(grid.GetSize());
+				for (int i = faceLower.x(); i < faceUpper.x(); i++) {
+					for (int j = faceLower.y(); j < faceUpper.y(); j++) {
+						int const index = grid.IndexOf(Vector2i(i, j));
+						int &slot = slots[axis][index];
+						if (pass == 1) {
+							// Slots only settle once all faces are added and removed
+							if (slot >= 0) dirtySlots.push_back(slot);
+						} else if (m_Fraction[axis][index] == 1. && slot < 0) {
+							slot = static_cast<int>(m_EnforcedFaces.size());
+							m_EnforcedFaces.push_back({ .Axis = axis, .Index = index });
+						} else if (m_Fraction[axis][index] != 1. && slot >= 0) {
+							auto const &last = m_EnforcedFaces.back();
+							slots[last.Axis][last.Index] = slot;
+							m_EnforcedFaces[slot] = last;
+							m_EnforcedFaces.pop_back();
+							slot = -1;
+						}
+					}
+				}
+			}
+		}
+		tbb::parallel_for(0, static_cast<int>(dirtySlots.size()), [&](int i) {
+			UpdateEnforcedFace(m_EnforcedFaces[dirtySlots[i]]);
 		});
+	}
 
-		ParallelForEach(m_Fraction.GetGrids(), [&](int axis, Vector2i const &face) {
-			m_Fraction[axis][face] = CalcFaceFraction(axis, face);
-			double sum = 0;
-			for (int i = 0; i < StaggeredGrid::GetNumNodesPerFace(); i++) {
-				sum += levelSetDrvs[axis][StaggeredGrid::NodeOfFace(axis, face, i)];
+	void Collider::BuildEnforcedFaces() {
+		m_EnforcedFaces.clear();
+		for (int axis = 0; axis < 2; axis++) {
+			auto const indices = ParallelFilter(m_Fraction[axis].GetGrid().GetNumVertices(), [&](int index) { return m_Fraction[axis][index] == 1.; });
+			for (auto const index : indices) {
+				if (m_EnforcedFaceSlots) {
+					(*m_EnforcedFaceSlots)[axis][index] = static_cast<int>(m_EnforcedFaces.size());
+				}
+				m_EnforcedFaces.push_back({ .Axis = axis, .Index = index });
 			}
-			m_Normal[axis][face] = sum / StaggeredGrid::GetNumNodesPerFace();
+		}
+		tbb::parallel_for(0, static_cast<int>(m_EnforcedFaces.size()), [&](int i) {
+			UpdateEnforcedFace(m_EnforcedFaces[i]);
 		});
 	}
 
+	void Collider::UpdateEnforcedFace(EnforcedFace &enforced) const {
+		auto const &grids = m_Fraction.GetGrids();
+		Vector2d const pos = grids[enforced.Axis].PositionOf(grids[enforced.Axis].CoordOf(enforced.Index));
+		for (int axis = 0; axis < 2; axis++) {
+			auto const points = BiLerp::GetWtPoints(grids[axis], pos);
+			for (int k = 0; k < 4; k++) {
+				enforced.Points[axis][k] = grids[axis].IndexOf(grids[axis].Clamp(points[k].first));
+				enforced.Weights[axis][k] = points[k].second;
+			}
+		}
+		// Deep in the solid the normal vanishes and the face only takes the velocity around it
+		enforced.Normal = BiLerp::Interpolate(m_Normal, pos).normalized();
+		enforced.Velocity = BiLerp::Interpolate(Velocity, pos);
+	}
+
 	double Collider::CalcFaceFraction(int axis, Vector2i const &face) const {
-		constexpr auto theta = [](double phi0, double phi1) { return phi0 / (phi0 - phi1); };
+		static constexpr auto theta = [](double phi0, double phi1) { return phi0 / (phi0 - phi1); };
 
-		constexpr auto fraction = [](const double phi0, const double phi1) {
+		static constexpr auto fraction = [](const double phi0, const double phi1) {
 			if (phi0 <= 0 && phi1 <= 0) {
 				return 1.;
 			} else if (phi0 <= 0 && phi1 > 0) {
@@ -65,16 +250,30 @@ namespace Pivot {
 		return faceFraction > .9 ? 1. : faceFraction;
 	}
 
-	void Collider::Enforce(SGridData<double> &fluidVelocity) const {
-		auto const oldFluidVelocity = fluidVelocity;
-		ParallelForEach(fluidVelocity.GetGrids(), [&](int axis, Vector2i const &face) {
-			if (m_Fraction[axis][face] == 1.) {
-				Vector2d const pos = fluidVelocity[axis].GetGrid().PositionOf(face);
-				Vector2d const vel = BiLerp::Interpolate(oldFluidVelocity, pos);
-				Vector2d const vel0 = BiLerp::Interpolate(Velocity, pos);
-				Vector2d const n = BiLerp::Interpolate(m_Normal, pos).normalized();
-				fluidVelocity[axis][face] = (vel - (vel - vel0).dot(n) * n)[axis];
+	double Collider::Enforce(SGridData<double> &fluidVelocity) const {
+		// Solid faces interpolate the velocity around them, so their new values are gathered before any is written
+		int const numFaces = static_cast<int>(m_EnforcedFaces.size());
+		std::vector<double> values(numFaces);
+		ParallelFor(numFaces, { .Kernel = "collider.enforce" }, [&](int begin, int end) {
+			for (int i = begin; i < end; i++) {
+				auto const &enforced = m_EnforcedFaces[i];
+				Vector2d vel = Vector2d::Zero();
+				for (int axis = 0; axis < 2; axis++) {
+					for (int k = 0; k < 4; k++) {
+						vel[axis] += fluidVelocity[axis][enforced.Points[axis][k]] * enforced.Weights[axis][k];
+					}
+				}
+				Vector2d const &n = enforced.Normal;
+				values[i] = (vel - (vel - enforced.Velocity).dot(n) * n)[enforced.Axis];
+			}
+		});
+		tbb::combinable<double> maxAbsValue(0.);
+		ParallelFor(numFaces, { .Kind = Partitioner::Static, .Grain = 1024 }, [&](int begin, int end) {
+			for (int i = begin; i < end; i++) {
+				fluidVelocity[m_EnforcedFaces[i].Axis][m_EnforcedFaces[i].Index] = values[i];
+				maxAbsValue.local() = std::max(maxAbsValue.local(), std::abs(values[i]));
 			}
 		});
+		return maxAbsValue.combine([](double lhs, double rhs) { return std::max(lhs, rhs); });
 	}
 }
@@ -6,6 +6,18 @@
 
 namespace Pivot {
 	class Collider {
+	public:
+		// A rigid solid moving with constant velocities, given by its shape at time zero. The shape rotates about the
+		// pivot, which moves with the linear velocity.
+		struct Body {
+			std::unique_ptr<Surface> Shape;
+			Vector2d                 Pivot;
+			Vector2d                 BoundsMin; // of the box bounding the shape at time zero
+			Vector2d                 BoundsMax;
+			Vector2d                 LinearVelocity = Vector2d::Zero();
+			double                   AngularVelocity = 0;
+		};
+
 	public:
 		explicit Collider(StaggeredGrid const &sgrid);
 
@@ -16,12 +28,50 @@ namespace Pivot {
 
 		bool IsInside(Vector2i const &cell) const { return m_AuxLevelSet[cell] <= 0; }
 
-		void Finish(StaggeredGrid const &sgrid);
+		// Bodies are added to the static solid described by LevelSet before the collider is finished.
+		void AddBody(Body body);
+		bool HasBodies() const { return !m_Bodies.empty(); }
+		// Bounds the speed of any point of the bodies, zero without bodies.
+		double GetMaxBodySpeed() const;
+
+		// Clamps LevelSet, composed of exact primitive distances through CSG, to a narrow band and derives the face
+		// quantities from it.
+		void Finish();
 
-		void Enforce(SGridData<double> &fluidVelocity) const;
+		// Moves the bodies to their places at the given time, updating only the region each of them sweeps.
+		void MoveBodies(double time);
+
+		// Returns the largest velocity component written.
+		double Enforce(SGridData<double> &fluidVelocity) const;
 
 	private:
+		// A fully solid face with the bilinear stencils of the fluid velocity at its position
+		struct EnforcedFace {
+			int                                  Axis;
+			int                                  Index;
+			std::array<std::array<int, 4>, 2>    Points   = {}; // indices into the x- and y-face data
+			std::array<std::array<double, 4>, 2> Weights  = {};
+			Vector2d                             Normal   = Vector2d::Zero(); // normalized
+			Vector2d                             Velocity = Vector2d::Zero();
+		};
+
+		// Nodes farther than this many cells from the solid boundary are clamped to the band, and faces beyond it get
+		// no normal
+		static constexpr int c_NumBandSteps = 8;
+
+		double GetBandWidth() const { return c_NumBandSteps * LevelSet.GetGrid().GetSpacing(); }
+
+		Vector2d BodyCenterOf  (Body const &body, double time) const { return body.Pivot + body.LinearVelocity * time; }
+		double   BodyDistanceTo(Body const &body, Vector2d const &pos) const;
+		Vector2d BodyVelocityAt(Body const &body, Vector2d const &pos) const;
+		// The node box [lower, upper) covering the band around the body at the given time
+		std::pair<Vector2i, Vector2i> CalcBodyRegion(Body const &body, double time) const;
+
 		double CalcFaceFraction(int axis, Vector2i const &face) const;
+		void UpdateFace(int axis, Vector2i const &face);
+		void UpdateRegion(Vector2i const &lower, Vector2i const &upper);
+		void BuildEnforcedFaces();
+		void UpdateEnforcedFace(EnforcedFace &enforced) const;
 
 	public:
 		GridData<double>  LevelSet;
@@ -32,5 +82,12 @@ namespace Pivot {
 		SGridData<double> m_Fraction;
 		SGridData<double> m_Normal;
 		GridData<double>  m_AuxLevelSet;
+
+		std::vector<EnforcedFace> m_EnforcedFaces;
+
+		std::vector<Body>               m_Bodies;
+		double                          m_BodyTime = 0;
+		std::optional<GridData<double>> m_StaticLevelSet;    // LevelSet without the bodies
+		std::optional<SGridData<int>>   m_EnforcedFaceSlots; // index into m_EnforcedFaces of every face, or -1
 	};
 }
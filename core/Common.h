@@ -40,6 +40,7 @@
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 
 namespace YAML {
 	template <typename Derived, int Rows>
@@ -52,6 +53,14 @@ namespace YAML {
 			node.SetStyle(EmitterStyle::Flow);
 			return node;
 		}
+
+		static bool decode(Node const &node, Eigen::Matrix<Derived, Rows, 1> &rhs) {
+			if (!node.IsSequence() || node.size() != Rows) return false;
+			for (std::size_t i = 0; i < Rows; i++) {
+				rhs(i) = node[i].as<Derived>();
+			}
+			return true;
+		}
 	};
 }
 
@@ -87,6 +87,19 @@ void Contour::Generate(GridData<double> const &grData, double value) {
                 static_cast<std::uint32_t>(m_EdgeMark[axis][edge]));
         }
     });
+
+    // Along the polylines, renumbering the vertices of the edges
+    m_Mesh.BuildComponents(m_NewIndices);
+    for (auto &edgeMark : m_EdgeMark) {
+        auto &marks = edgeMark.GetData();
+        tbb::parallel_for(std::size_t(0), marks.size(), [&](std::size_t i) {
+            if (marks[i] >= 0) {
+                marks[i] = static_cast<int>(m_NewIndices[marks[i]]);
+            }
+        });
+    }
+    // For the distance queries of this contour
+    m_Mesh.BuildQueryGrid();
 }
 
 void Contour::ComputeVertexInfos() { m_Mesh.ComputeMeanCurvatures(); }
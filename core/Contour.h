@@ -27,5 +27,6 @@ namespace Pivot {
 		std::array<GridData<int>, 2>        m_EdgeMark;
 
 		SurfaceMesh                         m_Mesh;
+		std::vector<std::uint32_t>          m_NewIndices; // of the vertices along the components
 	};
 }
@@ -1,31 +1,68 @@
 #include "Extrapolation.h"
 
 namespace Pivot {
-	void Extrapolation::Solve(GridData<double> &grData, double clearVal, int maxSteps, GridData<std::uint8_t> &valid) {
-		auto valid1 = valid;
-		for (int iter = 0; iter < maxSteps; iter++) {
-			ParallelForEach(grData.GetGrid(), [&](Vector2i const &coord) {
-				if (!valid[coord]) {
+	void Extrapolation::Solve(GridData<double> &grData, double clearVal, int maxSteps, GridData<std::uint8_t> const &valid) {
+		auto const validIndices = ParallelFilter(grData.GetGrid().GetNumVertices(), [&](int index) { return valid[index] != 0; });
+		Solve(grData, clearVal, maxSteps, valid, validIndices);
+	}
+
+	void Extrapolation::Solve(GridData<double> &grData, double clearVal, int maxSteps, GridData<std::uint8_t> const &valid, std::span<int const> validIndices) {
+		if (maxSteps <= 0) return;
+		Grid const &grid = grData.GetGrid();
+		// Values that no step reaches are cleared
+		ParallelFor(grid.GetNumVertices(), { .Kind = Partitioner::Static, .Grain = 1024 }, [&](int begin, int end) {
+			for (int index = begin; index < end; index++) {
+				if (!valid[index]) grData[index] = clearVal;
+			}
+		});
+		// Every step fills the invalid neighbors of the previous front from their valid neighbors
+		GridData<std::uint8_t> filled = valid;
+		std::vector<int> front(validIndices.begin(), validIndices.end());
+		for (int iter = 0; iter < maxSteps && !front.empty(); iter++) {
+			tbb::enumerable_thread_specific<std::vector<int>> candidates;
+			ParallelFor(static_cast<int>(front.size()), { .Kind = Partitioner::Static, .Grain = 256 }, [&](int begin, int end) {
+				auto &local = candidates.local();
+				for (int k = begin; k < end; k++) {
+					Vector2i const coord = grid.CoordOf(front[k]);
+					for (int i = 0; i < Grid::GetNumNeighbors(); i++) {
+						Vector2i const nbCoord = Grid::NeighborOf(coord, i);
+						if (grid.IsValid(nbCoord) && !filled[nbCoord]) local.push_back(grid.IndexOf(nbCoord));
+					}
+				}
+			});
+			front.clear();
+			for (auto const &local : candidates) front.insert(front.end(), local.begin(), local.end());
+			tbb::parallel_sort(front.begin(), front.end());
+			front.erase(std::unique(front.begin(), front.end()), front.end());
+
+			ParallelFor(static_cast<int>(front.size()), { .Kernel = "extrapolation" }, [&](int begin, int end) {
+				for (int k = begin; k < end; k++) {
+					Vector2i const coord = grid.CoordOf(front[k]);
 					int    cnt = 0;
 					double sum = 0;
 					for (int i = 0; i < Grid::GetNumNeighbors(); i++) {
 						Vector2i const nbCoord = Grid::NeighborOf(coord, i);
-						if (grData.GetGrid().IsValid(nbCoord) && valid[nbCoord]) {
+						if (grid.IsValid(nbCoord) && filled[nbCoord]) {
 							sum += grData[nbCoord];
 							cnt++;
 						}
 					}
-					if (cnt > 0) {
-						grData[coord] = sum / cnt;
-						valid1[coord] = true;
-					} else {
-						grData[coord] = clearVal;
-					}
-				} else {
-					valid1[coord] = true;
+					grData[front[k]] = sum / cnt;
 				}
 			});
-			valid.GetData().swap(valid1.GetData());
+			for (auto const index : front) filled[index] = true;
+		}
+	}
+
+	void Extrapolation::Solve(SGridData<double> &sgrData, double clearVal, int maxSteps, SGridData<std::uint8_t> const &valid) {
+		for (int axis = 0; axis < 2; axis++) {
+			Solve(sgrData[axis], clearVal, maxSteps, valid[axis]);
+		}
+	}
+
+	void Extrapolation::Solve(SGridData<double> &sgrData, double clearVal, int maxSteps, SGridData<std::uint8_t> const &valid, std::array<std::span<int const>, 2> const &validIndices) {
+		for (int axis = 0; axis < 2; axis++) {
+			Solve(sgrData[axis], clearVal, maxSteps, valid[axis], validIndices[axis]);
 		}
 	}
 }
@@ -3,7 +3,11 @@
 namespace Pivot {
 	class Extrapolation {
 	public:
-		static void Solve(GridData<double> &grData, double clearVal, int maxSteps, GridData<std::uint8_t> &valid);
+		static void Solve(GridData<double> &grData, double clearVal, int maxSteps, GridData<std::uint8_t> const &valid);
+		static void Solve(SGridData<double> &sgrData, double clearVal, int maxSteps, SGridData<std::uint8_t> const &valid);
+		// validIndices lists the valid entries, so that only the band around them is visited
+		static void Solve(GridData<double> &grData, double clearVal, int maxSteps, GridData<std::uint8_t> const &valid, std::span<int const> validIndices);
+		static void Solve(SGridData<double> &sgrData, double clearVal, int maxSteps, SGridData<std::uint8_t> const &valid, std::array<std::span<int const>, 2> const &validIndices);
 
 		template <typename Func>
 			requires std::is_convertible_v<Func, std::function<bool(Vector2i const &)>>
@@ -11,7 +15,7 @@ namespace Pivot {
 			GridData<std::uint8_t> valid(grData.GetGrid());
 			ParallelForEach(grData.GetGrid(), [&](Vector2i const &coord) {
 				valid[coord] = isValid(coord);
-			});
+			}, { .Kind = Partitioner::Static, .Grain = 1024 });
 			Solve(grData, clearVal, maxSteps, valid);
 		}
 
@@ -21,10 +25,8 @@ namespace Pivot {
 			SGridData<std::uint8_t> valid(sgrData.GetGrids());
 			ParallelForEach(sgrData.GetGrids(), [&](int axis, Vector2i const &face) {
 				valid[axis][face] = isValid(axis, face);
-			});
-			tbb::parallel_for(0, 2, [&](int axis) {
-				Solve(sgrData[axis], clearVal, maxSteps, valid[axis]);
-			});
+			}, { .Kind = Partitioner::Static, .Grain = 1024 });
+			Solve(sgrData, clearVal, maxSteps, valid);
 		}
 	};
 }
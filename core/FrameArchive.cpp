@@ -0,0 +1,313 @@
+#include "FrameArchive.h"
+
+namespace Pivot {
+	template <typename T>
+	static void Append(std::vector<std::byte> &buffer, T const &val) {
+		auto const bytes = std::as_bytes(std::span(&val, 1));
+		buffer.insert(buffer.end(), bytes.begin(), bytes.end());
+	}
+
+	template <typename T>
+	static T Extract(std::span<std::byte const> &bytes) {
+		T val;
+		std::memcpy(&val, bytes.data(), sizeof(T));
+		bytes = bytes.subspan(sizeof(T));
+		return val;
+	}
+
+	static void AppendVarint(std::vector<std::byte> &buffer, std::uint32_t val) {
+		while (val >= 0x80) {
+			buffer.push_back(static_cast<std::byte>((val & 0x7f) | 0x80));
+			val >>= 7;
+		}
+		buffer.push_back(static_cast<std::byte>(val));
+	}
+
+	static std::uint32_t ExtractVarint(std::span<std::byte const> &bytes) {
+		std::uint32_t val = 0;
+		for (int shift = 0; !bytes.empty(); shift += 7) {
+			auto const byte = static_cast<std::uint32_t>(bytes.front());
+			bytes = bytes.subspan(1);
+			val |= (byte & 0x7f) << shift;
+			if (!(byte & 0x80)) break;
+		}
+		return val;
+	}
+
+	static bool MatchTag(char const (&lhs)[4], char const *rhs) { return std::memcmp(lhs, rhs, 4) == 0; }
+
+	FrameWriter::FrameWriter(std::filesystem::path const &filename, std::uint32_t beginFrame) {
+		auto endOffset = static_cast<std::uint64_t>(sizeof(FrameArchive::FileHeader));
+		bool const resume = beginFrame > 0 && std::filesystem::exists(filename);
+		if (resume) {
+			FrameReader reader(filename);
+			for (std::size_t k = 0; k < reader.GetNumFrames() && reader.GetFrameInfo(k).Frame < beginFrame; k++) {
+				m_Index.push_back(reader.GetFrameInfo(k));
+				endOffset = m_Index.back().Offset + m_Index.back().Size;
+			}
+		}
+		if (resume) {
+			// Drops the later frames and the index table, which is written again on closing
+			std::filesystem::resize_file(filename, endOffset);
+			m_Out.open(filename, std::ios::binary | std::ios::in | std::ios::out);
+		} else {
+			m_Out.open(filename, std::ios::binary | std::ios::trunc);
+		}
+		if (!m_Out) {
+			spdlog::critical("Failed to open frame archive \"{}\"", filename.string());
+			std::exit(EXIT_FAILURE);
+		}
+		// A zero index offset marks the archive as not closed until Close
+		IO::Write(m_Out, FrameArchive::FileHeader());
+		m_Out.seekp(endOffset);
+	}
+
+	FrameWriter::~FrameWriter() {
+		Close();
+	}
+
+	void FrameWriter::BeginFrame(std::uint32_t frame, double time) {
+		m_FrameOffset = static_cast<std::uint64_t>(m_Out.tellp());
+		m_Frame = FrameArchive::FrameHeader();
+		m_Frame.Frame = frame;
+		m_Frame.Time = time;
+		IO::Write(m_Out, m_Frame);
+	}
+
+	void FrameWriter::WriteMesh(SurfaceMesh const &mesh, std::span<double const> magneticPressure) {
+		FrameArchive::MeshHeader header;
+		header.NumVertices = static_cast<std::uint32_t>(mesh.Positions.size());
+		header.NumIndices = static_cast<std::uint32_t>(mesh.Indices.size());
+		header.NumCurvatures = mesh.MeanCurvatures.size() == mesh.Positions.size() ? header.NumVertices : 0;
+		header.NumPressures = magneticPressure.size() == mesh.Positions.size() ? header.NumVertices : 0;
+
+		m_Buffer.clear();
+		Append(m_Buffer, header);
+		for (auto const &pos : mesh.Positions) {
+			Append(m_Buffer, pos.cast<float>().eval());
+		}
+		for (auto const index : mesh.Indices) {
+			Append(m_Buffer, index);
+		}
+		for (std::uint32_t i = 0; i < header.NumCurvatures; i++) {
+			Append(m_Buffer, static_cast<float>(mesh.MeanCurvatures[i]));
+		}
+		for (std::uint32_t i = 0; i < header.NumPressures; i++) {
+			Append(m_Buffer, static_cast<float>(magneticPressure[i]));
+		}
+		WriteChunk("MESH", "", m_Buffer);
+	}
+
+	void FrameWriter::WriteField(std::string_view name, GridData<double> const &grData, FrameArchive::Encoding encoding) {
+		Grid const &grid = grData.GetGrid();
+		auto const &data = grData.GetData();
+
+		FrameArchive::FieldHeader header;
+		header.Spacing = grid.GetSpacing();
+		header.Size[0] = grid.GetSize().x();
+		header.Size[1] = grid.GetSize().y();
+		header.Origin[0] = grid.GetOrigin().x();
+		header.Origin[1] = grid.GetOrigin().y();
+		header.Format = encoding;
+		header.NumValues = static_cast<std::uint32_t>(data.size());
+
+		m_Buffer.clear();
+		if (encoding == FrameArchive::Encoding::Quantized) {
+			header.MinValue = std::numeric_limits<double>::max();
+			header.MaxValue = std::numeric_limits<double>::lowest();
+			for (auto const val : data) {
+				if (!std::isfinite(val)) continue;
+				header.MinValue = std::min(header.MinValue, val);
+				header.MaxValue = std::max(header.MaxValue, val);
+			}
+			if (header.MinValue > header.MaxValue) {
+				header.MinValue = header.MaxValue = 0;
+			}
+			double const scale = header.MaxValue > header.MinValue ? 65535 / (header.MaxValue - header.MinValue) : 0;
+			Append(m_Buffer, header);
+			// Smooth fields have small differences between neighboring samples, which the varint coding shrinks.
+			std::int32_t prev = 0;
+			for (auto const val : data) {
+				double const clamped = std::isnan(val) ? header.MinValue : std::clamp(val, header.MinValue, header.MaxValue);
+				auto const q = static_cast<std::int32_t>(std::lround((clamped - header.MinValue) * scale));
+				std::int32_t const delta = q - prev;
+				AppendVarint(m_Buffer, static_cast<std::uint32_t>(delta << 1 ^ delta >> 31));
+				prev = q;
+			}
+		} else {
+			Append(m_Buffer, header);
+			auto const bytes = std::as_bytes(std::span(data));
+			m_Buffer.insert(m_Buffer.end(), bytes.begin(), bytes.end());
+		}
+		WriteChunk("FILD", name, m_Buffer);
+	}
+
+	void FrameWriter::EndFrame() {
+		WritePadding(static_cast<std::uint64_t>(m_Out.tellp()));
+		auto const endOffset = static_cast<std::uint64_t>(m_Out.tellp());
+		m_Frame.Size = endOffset - m_FrameOffset;
+		m_Out.seekp(m_FrameOffset);
+		IO::Write(m_Out, m_Frame);
+		m_Out.seekp(endOffset);
+		m_Out.flush();
+
+		FrameArchive::IndexEntry entry;
+		entry.Frame = m_Frame.Frame;
+		entry.Time = m_Frame.Time;
+		entry.Offset = m_FrameOffset;
+		entry.Size = m_Frame.Size;
+		m_Index.push_back(entry);
+	}
+
+	void FrameWriter::Close() {
+		if (!m_Out.is_open()) return;
+		auto const indexOffset = static_cast<std::uint64_t>(m_Out.tellp());
+		FrameArchive::IndexHeader header;
+		header.NumFrames = static_cast<std::uint32_t>(m_Index.size());
+		IO::Write(m_Out, header);
+		IO::Write(m_Out, m_Index);
+
+		FrameArchive::FileHeader fileHeader;
+		fileHeader.IndexOffset = indexOffset;
+		m_Out.seekp(0);
+		IO::Write(m_Out, fileHeader);
+		m_Out.close();
+	}
+
+	void FrameWriter::WriteChunk(char const (&tag)[5], std::string_view name, std::span<std::byte const> payload) {
+		FrameArchive::ChunkHeader chunk;
+		std::memcpy(chunk.Tag, tag, 4);
+		chunk.NameLength = static_cast<std::uint32_t>(name.size());
+		chunk.Size = payload.size();
+		IO::Write(m_Out, chunk);
+		m_Out.write(name.data(), name.size());
+		WritePadding(name.size());
+		IO::Write(m_Out, payload);
+		WritePadding(payload.size());
+		m_Frame.NumChunks++;
+	}
+
+	void FrameWriter::WritePadding(std::uint64_t size) {
+		static constexpr char zeros[8] = { };
+		m_Out.write(zeros, FrameArchive::Align(size) - size);
+	}
+
+	FrameReader::FrameReader(std::filesystem::path const &filename) :
+		m_In(filename, std::ios::binary) {
+		FrameArchive::FileHeader header;
+		IO::Read(m_In, header);
+		if (!m_In || !MatchTag(header.Magic, "PFAR")) {
+			spdlog::critical("Failed to open frame archive \"{}\"", filename.string());
+			std::exit(EXIT_FAILURE);
+		}
+		if (header.IndexOffset) {
+			FrameArchive::IndexHeader index;
+			m_In.seekg(header.IndexOffset);
+			IO::Read(m_In, index);
+			m_Index.resize(index.NumFrames);
+			IO::Read(m_In, m_Index);
+		}
+		if (!header.IndexOffset || !m_In) {
+			spdlog::warn("Frame archive \"{}\" has no index table, rebuilding it", filename.string());
+			RebuildIndex();
+		}
+	}
+
+	void FrameReader::RebuildIndex() {
+		m_In.clear();
+		m_Index.clear();
+		auto offset = static_cast<std::uint64_t>(sizeof(FrameArchive::FileHeader));
+		while (true) {
+			FrameArchive::FrameHeader frame;
+			m_In.seekg(offset);
+			IO::Read(m_In, frame);
+			// A frame interrupted while being written has no size recorded.
+			if (!m_In || !MatchTag(frame.Magic, "FRME") || frame.Size == 0) break;
+			FrameArchive::IndexEntry entry;
+			entry.Frame = frame.Frame;
+			entry.Time = frame.Time;
+			entry.Offset = offset;
+			entry.Size = frame.Size;
+			m_Index.push_back(entry);
+			offset += frame.Size;
+		}
+		m_In.clear();
+	}
+
+	std::vector<std::string> FrameReader::GetChunkNames(std::size_t k) {
+		std::vector<std::string> names;
+		FrameArchive::FrameHeader frame;
+		m_In.seekg(m_Index[k].Offset);
+		IO::Read(m_In, frame);
+		for (std::uint32_t i = 0; i < frame.NumChunks; i++) {
+			FrameArchive::ChunkHeader chunk;
+			IO::Read(m_In, chunk);
+			std::string name(chunk.NameLength, '\0');
+			m_In.read(name.data(), name.size());
+			names.push_back(std::string(chunk.Tag, 4) + (name.empty() ? "" : ":" + name));
+			m_In.seekg(FrameArchive::Align(chunk.NameLength) - chunk.NameLength + FrameArchive::Align(chunk.Size), std::ios::cur);
+		}
+		return names;
+	}
+
+	bool FrameReader::SeekChunk(std::size_t k, char const (&tag)[5], std::string_view name, FrameArchive::ChunkHeader &chunk) {
+		FrameArchive::FrameHeader frame;
+		m_In.seekg(m_Index[k].Offset);
+		IO::Read(m_In, frame);
+		for (std::uint32_t i = 0; i < frame.NumChunks && m_In; i++) {
+			IO::Read(m_In, chunk);
+			std::string chunkName(chunk.NameLength, '\0');
+			m_In.read(chunkName.data(), chunkName.size());
+			m_In.seekg(FrameArchive::Align(chunk.NameLength) - chunk.NameLength, std::ios::cur);
+			if (MatchTag(chunk.Tag, tag) && chunkName == name) {
+				return true;
+			}
+			m_In.seekg(FrameArchive::Align(chunk.Size), std::ios::cur);
+		}
+		return false;
+	}
+
+	std::optional<FrameReader::Mesh> FrameReader::ReadMesh(std::size_t k) {
+		FrameArchive::ChunkHeader chunk;
+		if (!SeekChunk(k, "MESH", "", chunk)) return std::nullopt;
+		FrameArchive::MeshHeader header;
+		IO::Read(m_In, header);
+		Mesh mesh;
+		mesh.Positions.resize(header.NumVertices);
+		mesh.Indices.resize(header.NumIndices);
+		mesh.MeanCurvatures.resize(header.NumCurvatures);
+		mesh.MagneticPressures.resize(header.NumPressures);
+		IO::Read(m_In, mesh.Positions);
+		IO::Read(m_In, mesh.Indices);
+		IO::Read(m_In, mesh.MeanCurvatures);
+		IO::Read(m_In, mesh.MagneticPressures);
+		return m_In ? std::optional(std::move(mesh)) : std::nullopt;
+	}
+
+	std::optional<FrameReader::Field> FrameReader::ReadField(std::size_t k, std::string_view name) {
+		FrameArchive::ChunkHeader chunk;
+		if (!SeekChunk(k, "FILD", name, chunk)) return std::nullopt;
+		std::vector<std::byte> payload(chunk.Size);
+		IO::Read(m_In, payload);
+		if (!m_In) return std::nullopt;
+
+		std::span<std::byte const> bytes(payload);
+		auto const header = Extract<FrameArchive::FieldHeader>(bytes);
+		Field field {
+			.Grid = Grid(header.Spacing, Vector2i(header.Size[0], header.Size[1]), Vector2d(header.Origin[0], header.Origin[1])),
+			.Values = std::vector<double>(header.NumValues),
+		};
+		if (header.Format == FrameArchive::Encoding::Quantized) {
+			double const step = (header.MaxValue - header.MinValue) / 65535;
+			std::int32_t q = 0;
+			for (auto &val : field.Values) {
+				auto const zigzag = ExtractVarint(bytes);
+				q += static_cast<std::int32_t>(zigzag >> 1) ^ -static_cast<std::int32_t>(zigzag & 1);
+				val = header.MinValue + q * step;
+			}
+		} else {
+			std::memcpy(field.Values.data(), bytes.data(), std::min(bytes.size(), field.Values.size() * sizeof(double)));
+		}
+		return field;
+	}
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "GridData.h"
+#include "SurfaceMesh.h"
+
+namespace Pivot {
+	// A single-file container of simulation frames. Frames are appended as they are produced, and an index table
+	// written on closing maps every frame to its byte range, so that readers can seek to any frame directly.
+	//
+	// Layout (little endian, every record padded to 8 bytes):
+	//   FileHeader | { FrameHeader | { ChunkHeader | payload }* }* | IndexHeader | IndexEntry*
+	class FrameArchive {
+	public:
+		enum class Encoding : std::uint32_t {
+			Raw       = 0, // float64 values
+			Quantized = 1, // 16-bit quantized values, delta and varint coded
+		};
+
+		struct FileHeader {
+			char          Magic[4] = { 'P', 'F', 'A', 'R' };
+			std::uint32_t Version = 1;
+			std::uint64_t IndexOffset = 0; // zero if the archive was not closed properly
+		};
+
+		struct FrameHeader {
+			char          Magic[4] = { 'F', 'R', 'M', 'E' };
+			std::uint32_t Frame = 0;
+			double        Time = 0;
+			std::uint32_t NumChunks = 0;
+			std::uint32_t Reserved = 0;
+			std::uint64_t Size = 0; // including this header
+		};
+
+		struct ChunkHeader {
+			char          Tag[4] = { };
+			std::uint32_t NameLength = 0; // the name follows the header and is padded to 8 bytes
+			std::uint64_t Size = 0;       // payload size, excluding the name and padding
+		};
+
+		struct IndexHeader {
+			char          Magic[4] = { 'I', 'N', 'D', 'X' };
+			std::uint32_t NumFrames = 0;
+		};
+
+		struct IndexEntry {
+			std::uint32_t Frame = 0;
+			std::uint32_t Reserved = 0;
+			double        Time = 0;
+			std::uint64_t Offset = 0;
+			std::uint64_t Size = 0;
+		};
+
+		// Payload of a "MESH" chunk: the counts are followed by float32 positions, uint32 indices, float32 mean
+		// curvatures and float32 magnetic pressures (NumPressures is either zero or NumVertices).
+		struct MeshHeader {
+			std::uint32_t NumVertices = 0;
+			std::uint32_t NumIndices = 0;
+			std::uint32_t NumCurvatures = 0;
+			std::uint32_t NumPressures = 0;
+		};
+
+		// Payload of a "FILD" chunk: the header is followed by the encoded values.
+		struct FieldHeader {
+			double        Spacing = 0;
+			std::int32_t  Size[2] = { };
+			double        Origin[2] = { };
+			Encoding      Format = Encoding::Raw;
+			std::uint32_t NumValues = 0;
+			double        MinValue = 0; // quantization range
+			double        MaxValue = 0;
+		};
+
+		static constexpr std::uint64_t Align(std::uint64_t size) { return (size + 7) & ~std::uint64_t(7); }
+	};
+
+	class FrameWriter {
+	public:
+		// With beginFrame above zero, the frames of an existing archive before beginFrame are kept and the new ones
+		// are appended after them, so that a restarted run continues the archive of the interrupted one.
+		explicit FrameWriter(std::filesystem::path const &filename, std::uint32_t beginFrame = 0);
+		~FrameWriter();
+
+		FrameWriter(FrameWriter const &) = delete;
+		FrameWriter &operator=(FrameWriter const &) = delete;
+
+		void BeginFrame(std::uint32_t frame, double time);
+		void WriteMesh(SurfaceMesh const &mesh, std::span<double const> magneticPressure);
+		void WriteField(std::string_view name, GridData<double> const &grData, FrameArchive::Encoding encoding);
+		void EndFrame();
+
+		void Close();
+
+	private:
+		void WriteChunk(char const (&tag)[5], std::string_view name, std::span<std::byte const> payload);
+		void WritePadding(std::uint64_t size);
+
+	private:
+		std::ofstream                         m_Out;
+		FrameArchive::FrameHeader             m_Frame;
+		std::uint64_t                         m_FrameOffset = 0;
+		std::vector<FrameArchive::IndexEntry> m_Index;
+		std::vector<std::byte>                m_Buffer;
+	};
+
+	class FrameReader {
+	public:
+		struct Mesh {
+			std::vector<Vector2f>      Positions;
+			std::vector<std::uint32_t> Indices;
+			std::vector<float>         MeanCurvatures;
+			std::vector<float>         MagneticPressures;
+		};
+
+		struct Field {
+			Pivot::Grid         Grid;
+			std::vector<double> Values;
+		};
+
+	public:
+		explicit FrameReader(std::filesystem::path const &filename);
+
+		std::size_t                           GetNumFrames() const { return m_Index.size(); }
+		FrameArchive::IndexEntry const       &GetFrameInfo(std::size_t k) const { return m_Index[k]; }
+		std::vector<std::string>              GetChunkNames(std::size_t k);
+
+		std::optional<Mesh>  ReadMesh(std::size_t k);
+		std::optional<Field> ReadField(std::size_t k, std::string_view name);
+
+	private:
+		void RebuildIndex();
+		bool SeekChunk(std::size_t k, char const (&tag)[5], std::string_view name, FrameArchive::ChunkHeader &chunk);
+
+	private:
+		std::ifstream                         m_In;
+		std::vector<FrameArchive::IndexEntry> m_Index;
+	};
+}
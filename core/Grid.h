@@ -1,6 +1,6 @@
 #pragma once
 
-#include "Common.h"
+#include "Partition.h"
 
 namespace Pivot {
 	class Grid {
@@ -56,15 +56,24 @@ namespace Pivot {
 		}
 	}
 
+	// Visits the vertices of indices [begin, end) in memory order.
 	template <typename Func>
-		requires std::is_convertible_v<Func, std::function<void(Vector2i const &)>>
-	inline void ParallelForEach(Grid const &grid, Func &&func) {
-		tbb::parallel_for(tbb::blocked_range2d<int>(0, grid.GetSize().x(), 0, grid.GetSize().y()), [&](tbb::blocked_range2d<int> const &r) {
-			for (int i = r.rows().begin(); i != r.rows().end(); i++) {
-				for (int j = r.cols().begin(); j != r.cols().end(); j++) {
-					func(Vector2i(i, j));
-				}
+	inline void ForEachInRange(Grid const &grid, int begin, int end, Func &&func) {
+		Vector2i coord = grid.CoordOf(begin);
+		for (int index = begin; index < end; index++) {
+			func(coord);
+			if (++coord.y() == grid.GetSize().y()) {
+				coord.x()++;
+				coord.y() = 0;
 			}
+		}
+	}
+
+	template <typename Func>
+		requires std::is_convertible_v<Func, std::function<void(Vector2i const &)>>
+	inline void ParallelForEach(Grid const &grid, Func &&func, Partition const &partition = { }) {
+		ParallelFor(grid.GetNumVertices(), partition, [&](int begin, int end) {
+			ForEachInRange(grid, begin, end, func);
 		});
 	}
 
@@ -80,11 +89,16 @@ namespace Pivot {
 
 	template <typename Func>
 		requires std::is_convertible_v<Func, std::function<void(int, Vector2i const &)>>
-	inline void ParallelForEach(std::array<Grid, 2> const &grids, Func &&func) {
-		tbb::parallel_for(0, 2, [&](int axis) {
-			ParallelForEach(grids[axis], [&](Vector2i const &coord) {
-				func(axis, coord);
-			});
+	inline void ParallelForEach(std::array<Grid, 2> const &grids, Func &&func, Partition const &partition = { }) {
+		// Both face grids are iterated as one range, the y-faces following the x-faces
+		int const numXFaces = grids[0].GetNumVertices();
+		ParallelFor(numXFaces + grids[1].GetNumVertices(), partition, [&](int begin, int end) {
+			if (begin < numXFaces) {
+				ForEachInRange(grids[0], begin, std::min(end, numXFaces), [&](Vector2i const &face) { func(0, face); });
+			}
+			if (end > numXFaces) {
+				ForEachInRange(grids[1], std::max(begin, numXFaces) - numXFaces, end - numXFaces, [&](Vector2i const &face) { func(1, face); });
+			}
 		});
 	}
 }
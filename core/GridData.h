@@ -33,12 +33,12 @@ namespace Pivot {
 		Type const &operator[](int index) const { return m_Data[index]; }
 
 		Type GetMaxAbsValue() const requires (std::is_arithmetic_v<Type>) {
-			if (m_Data.empty()) {
-				return 0;
-			} else {
-				auto minmax = std::minmax_element(m_Data.begin(), m_Data.end());
-				return std::max(std::abs(*minmax.first), std::abs(*minmax.second));
-			}
+			return tbb::parallel_reduce(tbb::blocked_range<std::size_t>(0, m_Data.size(), 4096), Type(0), [&](tbb::blocked_range<std::size_t> const &r, Type maxAbs) {
+				for (std::size_t i = r.begin(); i != r.end(); i++) {
+					maxAbs = std::max(maxAbs, static_cast<Type>(std::abs(m_Data[i])));
+				}
+				return maxAbs;
+			}, [](Type lhs, Type rhs) { return std::max(lhs, rhs); });
 		}
 
 		void SetConstant(Type const &value) { std::fill(m_Data.begin(), m_Data.end(), value); }
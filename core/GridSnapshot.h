@@ -0,0 +1,134 @@
+#pragma once
+
+#include "GridData.h"
+#include "MappedFile.h"
+
+namespace Pivot {
+	// A self-describing dump of one GridData. The values start at a page boundary and are stored exactly as in
+	// memory, so a GridDataView can read them from the mapped file without copying.
+	class GridSnapshot {
+	public:
+		enum class TypeTag : std::uint32_t { Int8, UInt8, Int32, Float32, Float64 };
+		enum class Layout  : std::uint32_t { XMajor }; // index = y + size.y * x, as in Grid::IndexOf
+
+		struct Header {
+			char          Magic[4] = { 'P', 'G', 'S', 'N' };
+			std::uint32_t Version = 1;
+			TypeTag       Type = TypeTag::Float64;
+			Layout        Order = Layout::XMajor;
+			std::uint32_t ElementSize = 0;
+			std::uint32_t Reserved = 0;
+			double        Spacing = 0;
+			std::int32_t  Size[2] = { };
+			double        Origin[2] = { };
+			std::uint64_t DataOffset = 0;
+			std::uint64_t NumValues = 0;
+		};
+
+		static constexpr std::uint64_t c_DataAlignment = 4096;
+
+		template <typename Type>
+		static constexpr TypeTag TypeTagOf() {
+			if constexpr (std::is_same_v<Type, std::int8_t>) return TypeTag::Int8;
+			else if constexpr (std::is_same_v<Type, std::uint8_t>) return TypeTag::UInt8;
+			else if constexpr (std::is_same_v<Type, std::int32_t>) return TypeTag::Int32;
+			else if constexpr (std::is_same_v<Type, float>) return TypeTag::Float32;
+			else {
+				static_assert(std::is_same_v<Type, double>, "Unsupported snapshot type");
+				return TypeTag::Float64;
+			}
+		}
+
+		template <typename Type>
+		static void Save(std::filesystem::path const &filename, GridData<Type> const &grData) {
+			std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+			if (!out) {
+				spdlog::critical("Failed to write snapshot \"{}\"", filename.string());
+				std::exit(EXIT_FAILURE);
+			}
+			Grid const &grid = grData.GetGrid();
+			Header header;
+			header.Type = TypeTagOf<Type>();
+			header.ElementSize = sizeof(Type);
+			header.Spacing = grid.GetSpacing();
+			header.Size[0] = grid.GetSize().x();
+			header.Size[1] = grid.GetSize().y();
+			header.Origin[0] = grid.GetOrigin().x();
+			header.Origin[1] = grid.GetOrigin().y();
+			header.DataOffset = c_DataAlignment;
+			header.NumValues = grData.GetData().size();
+			IO::Write(out, header);
+			out.write(std::string(header.DataOffset - sizeof(Header), '\0').data(), header.DataOffset - sizeof(Header));
+			IO::Write(out, grData.GetData());
+		}
+	};
+
+	// A read-only GridData backed by a mapped snapshot. Copies share the same mapping.
+	template <typename Type>
+	class GridDataView {
+	public:
+		explicit GridDataView(std::filesystem::path const &filename) :
+			m_File { std::make_shared<MappedFile>(filename) },
+			m_Grid { ParseHeader(filename, m_File->GetBytes()) } {
+			auto const bytes = m_File->GetBytes().subspan(ReadHeader(m_File->GetBytes()).DataOffset);
+			m_Data = std::span(reinterpret_cast<Type const *>(bytes.data()), m_Grid.GetNumVertices());
+		}
+
+		Grid                const &GetGrid() const { return m_Grid; }
+		std::span<Type const>      GetData() const { return m_Data; }
+
+		Type const &operator[](Vector2i const &coord) const { return m_Data[m_Grid.IndexOf(coord)]; }
+		Type const &At        (Vector2i const &coord) const { return m_Data[m_Grid.IndexOf(m_Grid.Clamp(coord))]; }
+		Type const &operator[](int index)             const { return m_Data[index]; }
+
+		Type GetMaxAbsValue() const requires (std::is_arithmetic_v<Type>) {
+			if (m_Data.empty()) {
+				return 0;
+			} else {
+				auto minmax = std::minmax_element(m_Data.begin(), m_Data.end());
+				return std::max(std::abs(*minmax.first), std::abs(*minmax.second));
+			}
+		}
+
+		void CopyTo(GridData<Type> &grData) const {
+			if (grData.GetGrid() == m_Grid) {
+				std::copy(m_Data.begin(), m_Data.end(), grData.GetData().begin());
+			} else {
+				spdlog::critical("Failed to copy a snapshot to GridData with a different grid");
+				std::exit(EXIT_FAILURE);
+			}
+		}
+
+	private:
+		static GridSnapshot::Header ReadHeader(std::span<std::byte const> bytes) {
+			GridSnapshot::Header header;
+			if (bytes.size() >= sizeof(header)) {
+				std::memcpy(&header, bytes.data(), sizeof(header));
+			} else {
+				std::memset(header.Magic, 0, sizeof(header.Magic));
+			}
+			return header;
+		}
+
+		static Grid ParseHeader(std::filesystem::path const &filename, std::span<std::byte const> bytes) {
+			auto const header = ReadHeader(bytes);
+			bool const valid = std::memcmp(header.Magic, "PGSN", 4) == 0
+				&& header.Type == GridSnapshot::TypeTagOf<Type>()
+				&& header.Order == GridSnapshot::Layout::XMajor
+				&& header.ElementSize == sizeof(Type)
+				&& header.DataOffset % alignof(Type) == 0
+				&& header.NumValues == static_cast<std::uint64_t>(header.Size[0]) * header.Size[1]
+				&& header.DataOffset + header.NumValues * sizeof(Type) <= bytes.size();
+			if (!valid) {
+				spdlog::critical("Failed to open snapshot \"{}\" as GridData of the requested type", filename.string());
+				std::exit(EXIT_FAILURE);
+			}
+			return Grid(header.Spacing, Vector2i(header.Size[0], header.Size[1]), Vector2d(header.Origin[0], header.Origin[1]));
+		}
+
+	private:
+		std::shared_ptr<MappedFile> m_File;
+		Grid                        m_Grid;
+		std::span<Type const>       m_Data;
+	};
+}
@@ -67,11 +67,11 @@ namespace Pivot {
 
 		ImplicitEllipsoid(Vector2d const &center, Vector2d const &semiAxels) : m_Center(center), m_SemiAxels(semiAxels) { }
 
-		virtual Vector2d ClosestPositionOf(Vector2d const &pos) const override { return pos / pos.cwiseQuotient(m_SemiAxels).norm(); } // not accurate solution
+		virtual Vector2d ClosestPositionOf(Vector2d const &pos) const override { return m_Center + (pos - m_Center) / (pos - m_Center).cwiseQuotient(m_SemiAxels).norm(); } // not accurate solution
 		virtual Vector2d ClosestNormalOf  (Vector2d const &pos) const override { return (pos - ClosestPositionOf(pos)).normalized() * (Surrounds(pos) ? -1 : 1); }
 		virtual double   DistanceTo       (Vector2d const &pos) const override { return (pos - ClosestPositionOf(pos)).norm(); }
 		virtual double   SignedDistanceTo (Vector2d const &pos) const override { return DistanceTo(pos) * (Surrounds(pos) ? -1 : 1); }
-		virtual bool     Surrounds        (Vector2d const &pos) const override { return pos.cwiseQuotient(m_SemiAxels).squaredNorm() <= 1; }
+		virtual bool     Surrounds        (Vector2d const &pos) const override { return (pos - m_Center).cwiseQuotient(m_SemiAxels).squaredNorm() <= 1; }
 
 	private:
 		Vector2d m_Center;
@@ -1,40 +1,107 @@
 #pragma once
 
 #include "Collider.h"
-#include "omp.h"
+#include "Random.h"
+#include "SurfaceMesh.h"
+#include "Tracer.h"
 
 namespace Pivot {
 class Magnetic {
   private:
     friend class Simulation;
+    friend class SimBuilder;
 
   public:
+    enum class Method { FPI, MC, Panel };
+
+  public:
+    void SetSusceptibility(double chi) {
+        m_Chi = chi;
+        m_Lambda = (-m_Chi) / (2 + m_Chi);
+    }
+    void SetExternalField(Vector2d const &hext) { m_Hext = hext; }
+    void SetMethod(Method method) { m_Method = method; }
+    void SetNumSamples(int numSamples) { m_NumSample = numSamples; }
+    void SetReuseWalks(bool reuseWalks) { m_ReuseWalks = reuseWalks; }
+
+    void SetResampling(double spacing, double maxAngle) {
+        m_ResampleSpacing = spacing;
+        m_ResampleAngle = maxAngle;
+    }
+
     void Solve(SurfaceMesh &mesh) {
+        Tracer::Scope trace("magnetic");
+        if (m_ResampleSpacing <= 0) {
+            SolveOn(mesh);
+            return;
+        }
+        // On a coarser boundary, interpolated back to the vertices
+        std::optional<Tracer::Scope> phase;
+        phase.emplace("resample");
+        mesh.Resample(m_ResampleSpacing, m_ResampleAngle, m_ResampledMesh,
+                      m_ResampledVertices);
+        phase.reset();
+        std::vector<double> reference;
+        if (m_CheckResampling) {
+            phase.emplace("reference");
+            SolveOn(mesh);
+            reference = m_MagneticPressure;
+            phase.reset();
+        }
+        SolveOn(m_ResampledMesh);
         m_Mesh = &mesh;
-
-        InitSolver();
-        // SolveMagneticByMC();
-        SolveMagneticByFPI();
+        for (auto *values : {&m_MagneticPressure, &m_MagneticHn, &m_MagneticHt,
+                             &m_MagneticHnVariance, &m_MagneticHtVariance}) {
+            std::vector<double> coarse = std::move(*values);
+            values->resize(mesh.size());
+            tbb::parallel_for(0, mesh.size(), [&](int i) {
+                auto const &vertex = m_ResampledVertices[i];
+                (*values)[i] = (1 - vertex.Weight) * coarse[vertex.Lower] +
+                               vertex.Weight * coarse[vertex.Upper];
+            });
+        }
+        m_ResampleError = 0;
+        if (m_CheckResampling) {
+            double error = 0;
+            double norm = 0;
+            for (int i = 0; i < mesh.size(); i++) {
+                error += std::pow(m_MagneticPressure[i] - reference[i], 2);
+                norm += reference[i] * reference[i];
+            }
+            m_ResampleError = norm > 0 ? std::sqrt(error / norm) : 0;
+        }
     }
 
   private:
-    struct Sampler {
-        std::default_random_engine RandEngine;
-        std::discrete_distribution<> SegmentSampler;
-        std::uniform_real_distribution<double> RandRussianRoulette;
-    };
+    void SolveOn(SurfaceMesh &mesh) {
+        m_Mesh = &mesh;
+        m_NumVertices = mesh.size();
+
+        InitSolver();
+        if (m_Method == Method::MC) {
+            SolveMagneticByMC();
+        } else if (m_Method == Method::Panel) {
+            SolveMagneticByPanels();
+        } else {
+            SolveMagneticByFPI();
+        }
+    }
     void InitSolver() {
         m_MagneticPressure.resize(m_Mesh->size(), 0);
         m_MagneticHn.resize(m_Mesh->size(), 0);
         m_MagneticHt.resize(m_Mesh->size(), 0);
+        m_MagneticHnVariance.assign(m_Mesh->size(), 0);
+        m_MagneticHtVariance.assign(m_Mesh->size(), 0);
+        m_MaxStdError = 0;
     }
     void SolveMagneticByFPI() {
         int size = m_Mesh->size();
         VectorXd u(size);
-        VectorXd utmp(size);
         VectorXd b(size);
         MatrixXd A(size, size);
 
+        std::optional<Tracer::Scope> trace;
+        trace.emplace("assemble");
         for (int i = 0; i < size; i++) {
             b(i) = -2 * m_Lambda * m_Hext.dot(m_Mesh->Normals[i]);
             u(i) = b(i) / (1 - m_Lambda);
@@ -55,25 +122,9 @@ class Magnetic {
             }
         }
 
-        // fmt::print("\n");
-        int iter;
-        for (iter = 0; iter < m_NumIteration; iter++) {
-            utmp = A * u + b;
-            double L1 = (u - utmp).cwiseAbs().sum() / size;
-            double maxCoeff = (u - utmp).cwiseAbs().maxCoeff();
-            // fmt::print("Iter [{:02d}] L1({:.5f}) maxCoeff({:.5f})\n", iter,
-            // L1,
-            //            maxCoeff);
-            u = utmp;
-            if (maxCoeff < m_StopThres) {
-                break;
-            }
-        }
-        utmp = A * u + b;
-        double L1 = (u - utmp).cwiseAbs().sum() / size;
-        double maxCoeff = (u - utmp).cwiseAbs().maxCoeff();
-        // fmt::print("\nIter [{:02d}] L1({:.5e}) maxCoeff({:.5e})\n", iter, L1,
-        //            maxCoeff);
+        trace.reset();
+        trace.emplace("solve");
+        IterateFixedPoint(A, b, u);
         for (int i = 0; i < size; i++) {
             double w = m_MU * (1 + m_Chi) / (-m_Chi) * u(i);
             m_MagneticHn[i] = -w / (m_MU * (1 + m_Chi));
@@ -106,36 +157,315 @@ class Magnetic {
             m_MagneticPressure[i] = pressure;
         }
     }
+    // Collocates the equation at the midpoints of the segments of the mesh,
+    // taking the density constant on every segment. The kernel is integrated
+    // exactly over the segments near the collocation point, which removes the
+    // regularization of the point kernel, and by Gauss quadrature over the
+    // others. The fields of the segments are averaged to the vertices.
+    void SolveMagneticByPanels() {
+        int const numPanels = m_Mesh->Indices.size() / 2;
+        std::vector<Vector2d> midpoints(numPanels);
+        std::vector<Vector2d> normals(numPanels);
+        std::vector<double> lengths(numPanels);
+        for (int j = 0; j < numPanels; j++) {
+            auto const [a, b] = PanelEnds(j);
+            Vector2d const vertexNormal =
+                m_Mesh->Normals[m_Mesh->Indices[2 * j]] +
+                m_Mesh->Normals[m_Mesh->Indices[2 * j + 1]];
+            midpoints[j] = (a + b) / 2;
+            lengths[j] = (b - a).norm();
+            // Of the segment, pointing to the side of the vertex normals
+            normals[j] = lengths[j] > 0
+                             ? Vector2d(a.y() - b.y(), b.x() - a.x()) /
+                                   lengths[j]
+                             : vertexNormal.normalized();
+            if (normals[j].dot(vertexNormal) < 0) {
+                normals[j] = -normals[j];
+            }
+        }
+
+        VectorXd u(numPanels);
+        VectorXd b(numPanels);
+        MatrixXd A(numPanels, numPanels);
+        MatrixXd T(numPanels, numPanels);
+
+        std::optional<Tracer::Scope> trace;
+        trace.emplace("assemble");
+        for (int i = 0; i < numPanels; i++) {
+            b(i) = -2 * m_Lambda * m_Hext.dot(normals[i]);
+            u(i) = b(i) / (1 - m_Lambda);
+        }
+        // By columns, which are contiguous
+        tbb::parallel_for(0, numPanels, [&](int j) {
+            for (int i = 0; i < numPanels; i++) {
+                // The principal value over the segment itself vanishes
+                Vector2d const integral =
+                    i == j ? Vector2d::Zero().eval()
+                           : PanelIntegral(midpoints[i], j, lengths[j],
+                                           midpoints[j]);
+                Vector2d const nx = normals[i];
+                A(i, j) = 2 * m_Lambda * integral.dot(nx);
+                T(i, j) = integral.x() * nx.y() - integral.y() * nx.x();
+            }
+        });
+
+        trace.reset();
+        trace.emplace("solve");
+        IterateFixedPoint(A, b, u);
+
+        // The field inside the fluid, Hn n + Ht t, averaged over the segments
+        // of every vertex by length
+        int const size = m_Mesh->size();
+        VectorXd const ht = T * u;
+        std::vector<Vector2d> fields(size, Vector2d::Zero());
+        std::vector<double> weights(size, 0);
+        for (int j = 0; j < numPanels; j++) {
+            Vector2d const nx = normals[j];
+            Vector2d const tx = Vector2d(nx.y(), -nx.x());
+            Vector2d const field =
+                u(j) / m_Chi * nx + (m_Hext.dot(tx) - ht(j)) * tx;
+            for (int k = 0; k < 2; k++) {
+                std::uint32_t const v = m_Mesh->Indices[2 * j + k];
+                fields[v] += lengths[j] * field;
+                weights[v] += lengths[j];
+            }
+        }
+        tbb::parallel_for(0, size, [&](int i) {
+            Vector2d const nx = m_Mesh->Normals[i];
+            Vector2d const tx = Vector2d(nx.y(), -nx.x());
+            Vector2d const field = weights[i] > 0
+                                       ? (fields[i] / weights[i]).eval()
+                                       : m_Hext;
+            m_MagneticHn[i] = field.dot(nx);
+            m_MagneticHt[i] = field.dot(tx);
+            double Hn_ = m_MagneticHn[i] * (1 + m_Chi);
+
+            double pressure = 0;
+
+            pressure += m_MU * (1 + m_Chi) * 0.5 *
+                        (m_MagneticHn[i] * m_MagneticHn[i] -
+                         m_MagneticHt[i] * m_MagneticHt[i]);
+            pressure -=
+                m_MU * 0.5 * (Hn_ * Hn_ - m_MagneticHt[i] * m_MagneticHt[i]);
+            m_MagneticPressure[i] = pressure;
+        });
+    }
+    std::pair<Vector2d, Vector2d> PanelEnds(int j) const {
+        return {m_Mesh->Positions[m_Mesh->Indices[2 * j]],
+                m_Mesh->Positions[m_Mesh->Indices[2 * j + 1]]};
+    }
+    // Integrates 1 / 2pi (y - x) / |y - x|^2 over the segment, whose normal
+    // and tangential components give the kernels of the normal and the
+    // tangential fields at x. With p = a - x and q = b - x, the exact integral
+    // is 1 / 2pi (ln(|q| / |p|) t - atan2(p x q, p . q) n) for the direction t
+    // of the segment and its normal n = (-t_y, t_x).
+    Vector2d PanelIntegral(Vector2d const &x, int j, double length,
+                           Vector2d const &midpoint) const {
+        if (length == 0) {
+            return Vector2d::Zero();
+        }
+        auto const [a, b] = PanelEnds(j);
+        if ((midpoint - x).squaredNorm() >
+            c_NearFieldRatio * c_NearFieldRatio * length * length) {
+            Vector2d integral = Vector2d::Zero();
+            for (int g = 0; g < 3; g++) {
+                Vector2d const r = a + c_GaussPoints[g] * (b - a) - x;
+                integral += c_GaussWeights[g] * r / r.squaredNorm();
+            }
+            return length / (2.0 * m_PI) * integral;
+        }
+        Vector2d const p = a - x;
+        Vector2d const q = b - x;
+        Vector2d const t = (b - a) / length;
+        Vector2d const n = Vector2d(-t.y(), t.x());
+        double const angle =
+            std::atan2(p.x() * q.y() - p.y() * q.x(), p.dot(q));
+        double const logRatio = 0.5 * std::log(q.squaredNorm() /
+                                               p.squaredNorm());
+        return 1.0 / (2.0 * m_PI) * (logRatio * t - angle * n);
+    }
+    // Iterates u = A u + b from the given u until it settles or the iteration
+    // limit is reached, and records the statistics of the solve.
+    void IterateFixedPoint(MatrixXd const &A, VectorXd const &b, VectorXd &u) {
+        VectorXd utmp(u.size());
+        int iter;
+        for (iter = 0; iter < m_NumIteration; iter++) {
+            utmp = A * u + b;
+            double maxCoeff = (u - utmp).cwiseAbs().maxCoeff();
+            u = utmp;
+            if (maxCoeff < m_StopThres) {
+                break;
+            }
+        }
+        utmp = A * u + b;
+        double L1 = (u - utmp).cwiseAbs().sum() / u.size();
+        double maxCoeff = (u - utmp).cwiseAbs().maxCoeff();
+        m_NumIterations = iter;
+        m_ResidualL1 = L1;
+        m_ResidualMax = maxCoeff;
+    }
     void SolveMagneticByMC() {
-        SetRandomEngine();
+        Tracer::Scope trace("solve");
+        m_NumIterations = 0;
+        m_ResidualL1 = m_ResidualMax = 0;
+        // Shared by every walk of the solve. Each sample draws from its own
+        // stream named by the vertex, the sample and the solve, so the
+        // estimates do not depend on the number of threads.
+        m_SegmentSampler.Build(m_Mesh->Areas);
+        std::uint32_t const solveIndex = m_NumSolves++;
+        if (m_ReuseWalks) {
+            CacheWalks(solveIndex);
+            BuildClusters();
+        }
         int size = m_MagneticPressure.size();
-#pragma omp parallel for schedule(dynamic) default(shared)
-        for (int i = 0; i < size; i++) {
-            int tid = omp_get_thread_num();
+        tbb::parallel_for(0, size, [&](int i) {
             int xIdx = i;
             Vector2d x = m_Mesh->Positions[xIdx];
             Vector2d nx = m_Mesh->Normals[xIdx];
             Vector2d tx = Vector2d(nx.y(), -nx.x());
+            // With reused walks, the term of the external field in the
+            // sampled values is a control variate, taken with the kernel at
+            // the center of the cluster of the sample when the cluster is far
+            // from the vertex. Its mean is summed once per cluster then, and
+            // over the vertices of the near clusters.
+            double meanHn = 0;
+            double meanHt = 0;
+            if (m_ReuseWalks) {
+                int const numClusters = m_ClusterTerms.size();
+                for (int c = 0; c < numClusters; c++) {
+                    Vector2d r = m_ClusterCenters[c] - x;
+                    if (r.squaredNorm() > m_ClusterFarDistances[c]) {
+                        double scale = m_ClusterTerms[c] /
+                                       (std::max)(r.squaredNorm(), m_EpsMC);
+                        meanHn += r.dot(nx) * scale;
+                        meanHt += r.dot(tx) * scale;
+                        continue;
+                    }
+                    int const end = (std::min)((c + 1) * m_ClusterSize, size);
+                    for (int j = c * m_ClusterSize; j < end; j++) {
+                        if (j == xIdx) {
+                            continue;
+                        }
+                        r = m_Mesh->Positions[j] - x;
+                        double scale = m_Mesh->Areas[j] * TermOf(j) /
+                                       (std::max)(r.squaredNorm(), m_EpsMC);
+                        meanHn += r.dot(nx) * scale;
+                        meanHt += r.dot(tx) * scale;
+                    }
+                }
+                // Normalized like the samples, which are drawn over the
+                // whole mesh
+                meanHn /= m_Mesh->TotalArea;
+                meanHt /= m_Mesh->TotalArea;
+            }
             double sumHn = 0;
             double sumHt = 0;
-            for (int sample = 0; sample < m_NumSample; sample++) {
-                double weight;
-                double value;
-                int yIdx = _UniformSample(xIdx, tid);
-                Vector2d y = m_Mesh->Positions[yIdx];
-                value = WoB(yIdx, tid);
-
-                weight = dGdxd(x, y, nx, m_EpsMC) * m_Mesh->TotalArea;
-                sumHn += -weight * value - m_Lambda * weight * value +
-                         m_Lambda * m_Hext.dot(nx);
-                sumHn += m_Hext.dot(nx);
-
-                weight = dGdxd(x, y, tx, m_EpsMC) * m_Mesh->TotalArea;
-                sumHt += -weight * value;
-                sumHt += m_Hext.dot(tx);
+            double sumSqHn = 0;
+            double sumSqHt = 0;
+            // The noise of the cached walks adds to the variance of the
+            // samples, and is estimated from them as well
+            double sumCacheVarHn = 0;
+            double sumCacheVarHt = 0;
+            std::array<std::array<double, c_NumSamplesPerBlock>, 2> ys;
+            std::array<std::array<double, c_NumSamplesPerBlock>, 2> centers;
+            std::array<double, c_NumSamplesPerBlock> values;
+            std::array<double, c_NumSamplesPerBlock> terms;
+            std::array<double, c_NumSamplesPerBlock> cacheVars;
+            std::array<double, c_NumSamplesPerBlock> dGdn;
+            std::array<double, c_NumSamplesPerBlock> dGdt;
+            std::array<double, c_NumSamplesPerBlock> cacheVarHn;
+            std::array<double, c_NumSamplesPerBlock> cacheVarHt;
+            for (int begin = 0; begin < m_NumSample;
+                 begin += c_NumSamplesPerBlock) {
+                int const count =
+                    std::min(c_NumSamplesPerBlock, m_NumSample - begin);
+                for (int k = 0; k < count; k++) {
+                    RandomStream stream(m_Seed, xIdx, begin + k, solveIndex);
+                    int yIdx = SampleOtherThan(xIdx, stream);
+                    if (yIdx < 0) {
+                        ys[0][k] = centers[0][k] = x.x();
+                        ys[1][k] = centers[1][k] = x.y();
+                        values[k] = terms[k] = cacheVars[k] = 0;
+                        continue;
+                    }
+                    Vector2d const y = m_Mesh->Positions[yIdx];
+                    ys[0][k] = y.x();
+                    ys[1][k] = y.y();
+                    if (!m_ReuseWalks) {
+                        centers[0][k] = y.x();
+                        centers[1][k] = y.y();
+                        values[k] = WoB(yIdx, stream);
+                        terms[k] = cacheVars[k] = 0;
+                        continue;
+                    }
+                    // The control variate of a near cluster takes the kernel
+                    // at the sample itself, which cancels its term
+                    int const c = yIdx / m_ClusterSize;
+                    Vector2d const center =
+                        (m_ClusterCenters[c] - x).squaredNorm() >
+                                m_ClusterFarDistances[c]
+                            ? m_ClusterCenters[c]
+                            : y;
+                    centers[0][k] = center.x();
+                    centers[1][k] = center.y();
+                    terms[k] = TermOf(yIdx);
+                    values[k] = m_WalkRemainders[yIdx] + terms[k];
+                    cacheVars[k] = m_Mesh->Areas[yIdx] *
+                                   m_WalkVariances[yIdx] / m_Mesh->TotalArea;
+                }
+                // The kernels of a block are evaluated in one branchless loop
+                // over contiguous arrays, which the compiler vectorizes
+                for (int k = 0; k < count; k++) {
+                    double const rx = ys[0][k] - x.x();
+                    double const ry = ys[1][k] - x.y();
+                    double const scale =
+                        1 / (std::max)(rx * rx + ry * ry, m_EpsMC);
+                    double const kn = (rx * nx.x() + ry * nx.y()) * scale;
+                    double const kt = (rx * tx.x() + ry * tx.y()) * scale;
+                    double const cx = centers[0][k] - x.x();
+                    double const cy = centers[1][k] - x.y();
+                    double const cscale =
+                        terms[k] / (std::max)(cx * cx + cy * cy, m_EpsMC);
+                    dGdn[k] =
+                        kn * values[k] - (cx * nx.x() + cy * nx.y()) * cscale;
+                    dGdt[k] =
+                        kt * values[k] - (cx * tx.x() + cy * tx.y()) * cscale;
+                    cacheVarHn[k] = kn * kn * cacheVars[k];
+                    cacheVarHt[k] = kt * kt * cacheVars[k];
+                }
+                for (int k = 0; k < count; k++) {
+                    sumHn += dGdn[k];
+                    sumHt += dGdt[k];
+                    sumSqHn += dGdn[k] * dGdn[k];
+                    sumSqHt += dGdt[k] * dGdt[k];
+                    sumCacheVarHn += cacheVarHn[k];
+                    sumCacheVarHt += cacheVarHt[k];
+                }
             }
-            m_MagneticHn[i] = sumHn / m_NumSample;
-            m_MagneticHt[i] = sumHt / m_NumSample;
+            double const weight =
+                m_Mesh->TotalArea / (2.0 * m_PI) / m_NumSample;
+            m_MagneticHn[i] = (1 + m_Lambda) *
+                              (m_Hext.dot(nx) - weight * sumHn -
+                               m_Mesh->TotalArea / (2.0 * m_PI) * meanHn);
+            m_MagneticHt[i] = m_Hext.dot(tx) - weight * sumHt -
+                              m_Mesh->TotalArea / (2.0 * m_PI) * meanHt;
+            // Variances of the estimates from the spread of the samples
+            auto const varianceOf = [&](double sum, double sumSq) {
+                if (m_NumSample < 2) {
+                    return 0.;
+                }
+                double const mean = sum / m_NumSample;
+                return weight * weight * m_NumSample / (m_NumSample - 1) *
+                       (std::max)(sumSq - mean * sum, 0.);
+            };
+            double const cacheWeight = m_Mesh->TotalArea / (2.0 * m_PI);
+            m_MagneticHnVariance[i] =
+                (1 + m_Lambda) * (1 + m_Lambda) *
+                (varianceOf(sumHn, sumSqHn) +
+                 cacheWeight * cacheWeight * sumCacheVarHn / m_NumSample);
+            m_MagneticHtVariance[i] =
+                varianceOf(sumHt, sumSqHt) +
+                cacheWeight * cacheWeight * sumCacheVarHt / m_NumSample;
 
             double pressure = 0;
 
@@ -146,53 +476,117 @@ class Magnetic {
             pressure -=
                 m_MU * 0.5 * (Hn_ * Hn_ - m_MagneticHt[i] * m_MagneticHt[i]);
             m_MagneticPressure[i] = pressure;
+        });
+        m_MaxStdError = 0;
+        for (auto const variance : m_MagneticHnVariance) {
+            m_MaxStdError = (std::max)(m_MaxStdError, std::sqrt(variance));
         }
     }
-    void SetRandomEngine() {
-        std::random_device rdevice;
-        int max_num_threads = omp_get_max_threads();
-        m_Samplers.resize(max_num_threads);
-        for (int i = 0; i < max_num_threads; i++) {
-            m_Samplers[i].RandEngine = std::default_random_engine(rdevice());
-            m_Samplers[i].SegmentSampler = std::discrete_distribution<>(
-                m_Mesh->Areas.begin(), m_Mesh->Areas.end());
-            m_Samplers[i].RandRussianRoulette =
-                std::uniform_real_distribution<double>(0, 1);
-        }
+    // Estimates the remainder of the walk from every vertex after its first
+    // term. Every sample landing on a vertex reuses these walks in place of
+    // its own.
+    void CacheWalks(std::uint32_t solveIndex) {
+        Tracer::Scope trace("walks");
+        int size = m_MagneticPressure.size();
+        m_WalkRemainders.resize(size);
+        m_WalkVariances.resize(size);
+        tbb::parallel_for(0, size, [&](int i) {
+            double sum = 0;
+            double sumSq = 0;
+            for (int walk = 0; walk < m_NumWalks; walk++) {
+                RandomStream stream(m_Seed, i, c_CachedWalkStreams | walk,
+                                    solveIndex);
+                double value = WoB(i, stream);
+                sum += value;
+                sumSq += value * value;
+            }
+            double const mean = sum / m_NumWalks;
+            m_WalkRemainders[i] =
+                mean + 2 * m_Lambda * m_Hext.dot(m_Mesh->Normals[i]);
+            // Of the mean of the walks
+            m_WalkVariances[i] =
+                m_NumWalks < 2 ? 0.
+                               : (std::max)(sumSq - mean * sum, 0.) /
+                                     (m_NumWalks - 1) / m_NumWalks;
+        });
     }
-    double WoB(int idx, int tid = 0) {
-        Vector2d x = m_Mesh->Positions[idx];
-        Vector2d nx = m_Mesh->Normals[idx];
-
-        double boundaryValue = 2 * m_Lambda * m_Hext.dot(nx);
-        double rr =
-            m_Samplers[tid].RandRussianRoulette(m_Samplers[tid].RandEngine);
-        if (rr > m_RussianRoulette) {
-            return -boundaryValue;
+    // Groups the vertices into runs of about the square root of their number,
+    // contiguous along the components, which keeps the sums of the control
+    // variate over them at the power 3/2 of the number of vertices.
+    void BuildClusters() {
+        int const size = m_Mesh->size();
+        m_ClusterSize = (std::max)(
+            c_MinClusterSize, static_cast<int>(std::sqrt(double(size))));
+        int const numClusters = (size + m_ClusterSize - 1) / m_ClusterSize;
+        m_ClusterCenters.resize(numClusters);
+        m_ClusterFarDistances.resize(numClusters);
+        m_ClusterTerms.resize(numClusters);
+        tbb::parallel_for(0, numClusters, [&](int c) {
+            int const begin = c * m_ClusterSize;
+            int const end = (std::min)(begin + m_ClusterSize, size);
+            Vector2d center = Vector2d::Zero();
+            double term = 0;
+            for (int j = begin; j < end; j++) {
+                center += m_Mesh->Positions[j];
+                term += m_Mesh->Areas[j] * TermOf(j);
+            }
+            center /= end - begin;
+            double radius = 0;
+            for (int j = begin; j < end; j++) {
+                radius = (std::max)(
+                    radius, (m_Mesh->Positions[j] - center).squaredNorm());
+            }
+            m_ClusterCenters[c] = center;
+            // Squared, beyond which the cluster is far
+            m_ClusterFarDistances[c] =
+                c_ClusterFarRatio * c_ClusterFarRatio * radius;
+            m_ClusterTerms[c] = term;
+        });
+    }
+    // Of the external field at the vertex, the first term of its walks
+    double TermOf(int idx) const {
+        return -2 * m_Lambda * m_Hext.dot(m_Mesh->Normals[idx]);
+    }
+    // Walks on the boundary from the vertex: the unrolled form of
+    //   WoB(x) = -b(x) + w(x, y) WoB(y) / p,
+    // continued with the probability p of the Russian roulette.
+    double WoB(int idx, RandomStream &stream) const {
+        double value = 0;
+        double throughput = 1;
+        while (true) {
+            Vector2d x = m_Mesh->Positions[idx];
+            Vector2d nx = m_Mesh->Normals[idx];
+            value -= throughput * 2 * m_Lambda * m_Hext.dot(nx);
+            if (stream.NextDouble() > m_RussianRoulette) {
+                return value;
+            }
+            int yIdx = SampleOtherThan(idx, stream);
+            if (yIdx < 0) {
+                return value;
+            }
+            Vector2d y = m_Mesh->Positions[yIdx];
+            throughput *= 2 * m_Lambda * dGdxd(x, y, nx, m_EpsMC) *
+                          m_Mesh->TotalArea / m_RussianRoulette;
+            idx = yIdx;
         }
-
-        int yIdx = _UniformSample(idx, tid);
-        Vector2d y = m_Mesh->Positions[yIdx];
-        double weight = 2 * m_Lambda * dGdxd(x, y, nx, m_EpsMC) *
-                        m_Mesh->TotalArea / m_RussianRoulette;
-        return weight * WoB(yIdx, tid) - boundaryValue;
     }
-    int _UniformSample(int xIdx, int tid = 0) {
-        int idx;
-        do {
-            idx = m_Samplers[tid].SegmentSampler(m_Samplers[tid].RandEngine);
-        } while (idx == xIdx);
-        return idx;
+    // Samples a vertex by area over the whole mesh in constant time. The
+    // kernels leave out the source vertex, so a draw of it contributes
+    // nothing, which keeps the estimates unbiased with the total area as
+    // their weight; returns -1 then.
+    int SampleOtherThan(int xIdx, RandomStream &stream) const {
+        int const idx = m_SegmentSampler.Sample(stream.NextDouble());
+        return idx == xIdx ? -1 : idx;
     }
 
     double dGdxd(const Vector2d &x, const Vector2d &y, const Vector2d &xd,
-                 double eps) {
+                 double eps) const {
         Vector2d r = y - x;
         return 1.0 / (2.0 * m_PI) * r.dot(xd) /
                (std::max)(r.squaredNorm(), eps);
     }
     double dGdxdClamped(const Vector2d &x, const Vector2d &y,
-                        const Vector2d &xd, double eps) {
+                        const Vector2d &xd, double eps) const {
         Vector2d r = y - x;
         return (r.norm() < eps)
                    ? 0
@@ -202,23 +596,65 @@ class Magnetic {
   private:
     inline static const double m_PI = 3.141592653589783;
     inline static const double m_MU = 4e-7 * m_PI;
+    static constexpr int c_NumSamplesPerBlock = 64;
+    static constexpr int c_MinClusterSize = 16;
+    // Clusters farther than this many radii from the vertex take the kernel at
+    // their center in the control variate of the reused walks
+    static constexpr double c_ClusterFarRatio = 4;
+    // Segments farther than this many lengths from the collocation point are
+    // integrated by the three point Gauss rule
+    static constexpr double c_NearFieldRatio = 4;
+    static constexpr std::array<double, 3> c_GaussPoints = {
+        0.5 - 0.3872983346207417, 0.5, 0.5 + 0.3872983346207417};
+    static constexpr std::array<double, 3> c_GaussWeights = {5. / 18, 8. / 18,
+                                                             5. / 18};
+    // Set in the sample word of the streams of the cached walks
+    static constexpr std::uint32_t c_CachedWalkStreams = 0x80000000;
 
     SurfaceMesh *m_Mesh;
     std::vector<double> m_MagneticPressure;
     std::vector<double> m_MagneticHn;
     std::vector<double> m_MagneticHt;
+    std::vector<double> m_MagneticHnVariance; // of the Monte Carlo estimates
+    std::vector<double> m_MagneticHtVariance;
 
     double m_Chi = .5;
     double m_Lambda = (-m_Chi) / (2 + m_Chi);
     Vector2d m_Hext = Vector2d(0, 5e4);
 
+    Method m_Method = Method::FPI;
+
     double m_RussianRoulette = 0.5;
     int m_NumSample = 20000;
     double m_EpsMC = 1e-6;
-    std::vector<Sampler> m_Samplers;
+    bool m_ReuseWalks = false;
+    int m_NumWalks = 64; // cached from every vertex when the walks are reused
+    std::uint64_t m_Seed = 0;
+    std::uint32_t m_NumSolves = 0; // of the MC method, names its streams
+    AliasTable m_SegmentSampler;
+    std::vector<double> m_WalkRemainders;
+    std::vector<double> m_WalkVariances;
+    int m_ClusterSize = c_MinClusterSize; // of the control variate
+    std::vector<Vector2d> m_ClusterCenters;
+    std::vector<double> m_ClusterFarDistances;
+    std::vector<double> m_ClusterTerms; // summed over the vertices by area
+
+    // Of the coarser boundary the equation is solved on, 0 for the mesh itself
+    double m_ResampleSpacing = 0;
+    double m_ResampleAngle = .2; // turning per segment of the coarser boundary
+    bool m_CheckResampling = false; // against a solve on the mesh itself
+    SurfaceMesh m_ResampledMesh;
+    std::vector<SurfaceMesh::ResampledVertex> m_ResampledVertices;
 
     int m_NumIteration = 20;
     double m_EpsFPI = 1e-3;
     double m_StopThres = 1e-6;
+
+    int m_NumIterations = 0; // statistics of the last solve
+    int m_NumVertices = 0;
+    double m_ResidualL1 = 0;
+    double m_ResidualMax = 0;
+    double m_MaxStdError = 0; // of the normal field over the vertices
+    double m_ResampleError = 0; // relative, of the pressure when checked
 };
 } // namespace Pivot
@@ -0,0 +1,65 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Pivot {
+#ifdef _WIN32
+	MappedFile::MappedFile(std::filesystem::path const &filename) {
+		m_File = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		LARGE_INTEGER size;
+		if (m_File == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_File, &size)) {
+			spdlog::critical("Failed to open \"{}\" for mapping", filename.string());
+			std::exit(EXIT_FAILURE);
+		}
+		m_Size = static_cast<std::size_t>(size.QuadPart);
+		if (m_Size == 0) return;
+		m_Mapping = CreateFileMappingW(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_Mapping) {
+			m_Data = static_cast<std::byte const *>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+		}
+		if (!m_Data) {
+			spdlog::critical("Failed to map \"{}\"", filename.string());
+			std::exit(EXIT_FAILURE);
+		}
+	}
+
+	MappedFile::~MappedFile() {
+		if (m_Data) UnmapViewOfFile(m_Data);
+		if (m_Mapping) CloseHandle(m_Mapping);
+		if (m_File && m_File != INVALID_HANDLE_VALUE) CloseHandle(m_File);
+	}
+#else
+	MappedFile::MappedFile(std::filesystem::path const &filename) {
+		int const fd = open(filename.c_str(), O_RDONLY);
+		struct stat st;
+		if (fd < 0 || fstat(fd, &st) != 0) {
+			spdlog::critical("Failed to open \"{}\" for mapping", filename.string());
+			std::exit(EXIT_FAILURE);
+		}
+		m_Size = static_cast<std::size_t>(st.st_size);
+		if (m_Size > 0) {
+			void *const addr = mmap(nullptr, m_Size, PROT_READ, MAP_SHARED, fd, 0);
+			if (addr == MAP_FAILED) {
+				spdlog::critical("Failed to map \"{}\"", filename.string());
+				std::exit(EXIT_FAILURE);
+			}
+			m_Data = static_cast<std::byte const *>(addr);
+		}
+		// The mapping stays valid after the descriptor is closed.
+		close(fd);
+	}
+
+	MappedFile::~MappedFile() {
+		if (m_Data) munmap(const_cast<std::byte *>(m_Data), m_Size);
+	}
+#endif
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Common.h"
+
+namespace Pivot {
+	// A read-only memory mapping of a whole file. Pages are loaded lazily by the OS on first access.
+	class MappedFile {
+	public:
+		explicit MappedFile(std::filesystem::path const &filename);
+		~MappedFile();
+
+		MappedFile(MappedFile const &) = delete;
+		MappedFile &operator=(MappedFile const &) = delete;
+
+		std::span<std::byte const> GetBytes() const { return { m_Data, m_Size }; }
+
+	private:
+		std::byte const *m_Data = nullptr;
+		std::size_t      m_Size = 0;
+#ifdef _WIN32
+		void            *m_File = nullptr;
+		void            *m_Mapping = nullptr;
+#endif
+	};
+}
@@ -0,0 +1,122 @@
+#include "Partition.h"
+
+#include <mutex>
+
+namespace Pivot {
+	static constexpr int c_RunsPerCandidate = 3;
+	static constexpr int c_MaxTasksPerThread = 64; // bounds the finest grain a candidate may use
+
+	static std::mutex s_Mutex; // guards the entries
+
+	static std::unordered_map<std::string, Partitioner> const s_PartitionerFromName = {
+		{ "auto"    , Partitioner::Auto     },
+		{ "simple"  , Partitioner::Simple   },
+		{ "static"  , Partitioner::Static   },
+		{ "affinity", Partitioner::Affinity },
+	};
+
+	static std::string NameOf(Partitioner kind) {
+		for (auto const &[name, value] : s_PartitionerFromName) {
+			if (value == kind) return name;
+		}
+		return "auto";
+	}
+
+	void GrainTuner::Configure(Mode mode, std::filesystem::path const &filename) {
+		std::lock_guard lock(s_Mutex);
+		s_Mode = mode;
+		s_Filename = filename;
+		s_Entries.clear();
+		if (mode == Mode::Off || !std::filesystem::exists(filename)) return;
+		try {
+			YAML::Node const root = YAML::LoadFile(filename.string());
+			for (auto const &kernel : root) {
+				for (auto const &threads : kernel.second) {
+					for (auto const &size : threads.second) {
+						auto entry = std::make_unique<Entry>();
+						entry->Kernel = kernel.first.as<std::string>();
+						entry->NumThreads = threads.first.as<int>();
+						entry->NumItems = size.first.as<int>();
+						entry->Best.Kind = s_PartitionerFromName.at(size.second["partitioner"].as<std::string>());
+						entry->Best.Grain = size.second["grain"].as<int>();
+						entry->Tuned = true;
+						s_Entries[fmt::format("{}:{}:{}", entry->Kernel, entry->NumThreads, entry->NumItems)] = std::move(entry);
+					}
+				}
+			}
+		} catch (std::exception const &e) {
+			spdlog::critical("Failed to load grain cache \"{}\": {}", filename.string(), e.what());
+			std::exit(EXIT_FAILURE);
+		}
+	}
+
+	void GrainTuner::Save() {
+		std::lock_guard lock(s_Mutex);
+		if (s_Mode != Mode::Tune) return;
+		YAML::Node root;
+		for (auto const &[key, entry] : s_Entries) {
+			if (!entry->Tuned) continue;
+			YAML::Node node;
+			node["partitioner"] = NameOf(entry->Best.Kind);
+			node["grain"] = entry->Best.Grain;
+			node.SetStyle(YAML::EmitterStyle::Flow);
+			root[entry->Kernel][entry->NumThreads][entry->NumItems] = node;
+		}
+		std::ofstream out(s_Filename);
+		if (!out) {
+			spdlog::error("Failed to write grain cache \"{}\"", s_Filename.string());
+			return;
+		}
+		out << root << std::endl;
+	}
+
+	GrainTuner::Entry &GrainTuner::GetEntry(Partition const &partition, int numItems) {
+		int const numThreads = tbb::this_task_arena::max_concurrency();
+		auto const key = fmt::format("{}:{}:{}", partition.Kernel, numThreads, numItems);
+		std::lock_guard lock(s_Mutex);
+		auto &entry = s_Entries[key];
+		if (!entry) {
+			entry = std::make_unique<Entry>();
+			entry->Kernel = partition.Kernel;
+			entry->NumThreads = numThreads;
+			entry->NumItems = numItems;
+			entry->Best = partition;
+		}
+		return *entry;
+	}
+
+	int GrainTuner::NextCandidate(Entry &entry, Partition &partition) {
+		std::lock_guard lock(s_Mutex);
+		partition = entry.Best;
+		if (s_Mode != Mode::Tune || entry.Tuned) return -1;
+		if (entry.Candidates.empty()) {
+			// The partition of the loop itself, then the others with grains coarse enough that no thread gets
+			// more than a few dozen tasks, as tiny tasks of the simple partitioner never win on large loops
+			entry.Candidates.push_back(entry.Best);
+			int const minGrain = entry.NumItems / (entry.NumThreads * c_MaxTasksPerThread);
+			for (auto const kind : { Partitioner::Auto, Partitioner::Simple, Partitioner::Static, Partitioner::Affinity }) {
+				for (int grain = 64; grain <= 65536; grain *= 4) {
+					if (grain < minGrain || grain * 2 > entry.NumItems) continue;
+					if (kind == entry.Best.Kind && grain == entry.Best.Grain) continue;
+					entry.Candidates.push_back({ kind, grain, entry.Best.Kernel });
+				}
+			}
+			entry.Times.assign(entry.Candidates.size(), std::numeric_limits<double>::infinity());
+		}
+		int const candidate = entry.NumRuns / c_RunsPerCandidate;
+		if (candidate >= static_cast<int>(entry.Candidates.size())) return -1; // the last runs are still being recorded
+		entry.NumRuns++;
+		partition = entry.Candidates[candidate];
+		return candidate;
+	}
+
+	void GrainTuner::Record(Entry &entry, int candidate, double time) {
+		std::lock_guard lock(s_Mutex);
+		entry.Times[candidate] = std::min(entry.Times[candidate], time);
+		if (entry.NumRuns < static_cast<int>(entry.Candidates.size()) * c_RunsPerCandidate) return;
+		auto const best = std::min_element(entry.Times.begin(), entry.Times.end()) - entry.Times.begin();
+		entry.Best = entry.Candidates[best];
+		entry.Tuned = true;
+		spdlog::debug("Tuned {} over {} items with {} threads: {} partitioner, grain {}", entry.Kernel, entry.NumItems, entry.NumThreads, NameOf(entry.Best.Kind), entry.Best.Grain);
+	}
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "Common.h"
+
+#include <numeric>
+
+namespace Pivot {
+	enum class Partitioner { Auto, Simple, Static, Affinity };
+
+	// How a parallel loop is split into tasks. Naming the kernel lets GrainTuner replace the partitioner and
+	// grain with the best ones recorded for the loop size and thread count.
+	struct Partition {
+		Partitioner Kind   = Partitioner::Auto;
+		int         Grain  = 1;       // minimum items per task
+		char const *Kernel = nullptr; // string literal
+	};
+
+	class GrainTuner {
+	public:
+		enum class Mode { Off, Cached, Tune };
+
+		// Cached uses the entries of the cache file, Tune also times the candidates of missing entries.
+		static void Configure(Mode mode, std::filesystem::path const &filename);
+		// Writes every tuned entry back to the cache file when tuning.
+		static void Save();
+
+		template <typename Body>
+		static void Run(Partition const &partition, int numItems, Body &&body) {
+			if (partition.Kernel == nullptr || s_Mode == Mode::Off) {
+				body(partition, nullptr);
+				return;
+			}
+			Entry &entry = GetEntry(partition, numItems);
+			Partition part;
+			auto const candidate = NextCandidate(entry, part);
+			// When simulations run side by side, only one run of a kernel at a time replays its task placement
+			bool const ownsAffinity = !entry.AffinityInUse.test_and_set(std::memory_order_acquire);
+			if (candidate >= 0) {
+				auto const beginTime = std::chrono::steady_clock::now();
+				body(part, ownsAffinity ? &entry.Affinity : nullptr);
+				Record(entry, candidate, std::chrono::duration<double>(std::chrono::steady_clock::now() - beginTime).count());
+			} else {
+				body(part, ownsAffinity ? &entry.Affinity : nullptr);
+			}
+			if (ownsAffinity) entry.AffinityInUse.clear(std::memory_order_release);
+		}
+
+	private:
+		struct Entry {
+			std::string               Kernel;
+			int                       NumThreads;
+			int                       NumItems;
+			Partition                 Best;
+			bool                      Tuned = false;
+			std::vector<Partition>    Candidates;
+			std::vector<double>       Times;     // fastest run of every candidate
+			int                       NumRuns = 0;
+			tbb::affinity_partitioner Affinity;  // replays the task placement of previous runs
+			std::atomic_flag          AffinityInUse;
+		};
+
+		static Entry &GetEntry(Partition const &partition, int numItems);
+		// Sets partition to the candidate to time, or to the best one if the entry is tuned.
+		static int NextCandidate(Entry &entry, Partition &partition);
+		static void Record(Entry &entry, int candidate, double time);
+
+	private:
+		static inline Mode                                                    s_Mode = Mode::Off;
+		static inline std::filesystem::path                                   s_Filename;
+		static inline std::unordered_map<std::string, std::unique_ptr<Entry>> s_Entries; // keyed by kernel:threads:items
+	};
+
+	// Calls body(begin, end) on subranges of [0, numItems).
+	template <typename Body>
+	inline void ParallelFor(int numItems, Partition const &partition, Body &&body) {
+		GrainTuner::Run(partition, numItems, [&](Partition const &part, tbb::affinity_partitioner *affinity) {
+			tbb::blocked_range<int> const range(0, numItems, std::max(part.Grain, 1));
+			auto const kernel = [&](tbb::blocked_range<int> const &r) { body(r.begin(), r.end()); };
+			switch (part.Kind) {
+			case Partitioner::Simple:
+				tbb::parallel_for(range, kernel, tbb::simple_partitioner());
+				break;
+			case Partitioner::Static:
+				tbb::parallel_for(range, kernel, tbb::static_partitioner());
+				break;
+			case Partitioner::Affinity:
+				if (affinity) {
+					tbb::parallel_for(range, kernel, *affinity);
+				} else {
+					tbb::affinity_partitioner local;
+					tbb::parallel_for(range, kernel, local);
+				}
+				break;
+			default:
+				tbb::parallel_for(range, kernel, tbb::auto_partitioner());
+				break;
+			}
+		});
+	}
+
+	// Returns the indices in [0, numItems) that satisfy pred, in increasing order. Pred is called twice per index.
+	template <typename Pred>
+	inline std::vector<int> ParallelFilter(int numItems, Pred &&pred) {
+		constexpr int c_BlockSize = 4096;
+		int const numBlocks = (numItems + c_BlockSize - 1) / c_BlockSize;
+		std::vector<int> offsets(numBlocks + 1, 0);
+		tbb::parallel_for(0, numBlocks, [&](int block) {
+			int const end = std::min(numItems, (block + 1) * c_BlockSize);
+			for (int i = block * c_BlockSize; i < end; i++) {
+				offsets[block + 1] += pred(i) ? 1 : 0;
+			}
+		});
+		std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+		std::vector<int> indices(offsets.back());
+		tbb::parallel_for(0, numBlocks, [&](int block) {
+			int const end = std::min(numItems, (block + 1) * c_BlockSize);
+			for (int i = block * c_BlockSize, k = offsets[block]; i < end; i++) {
+				if (pred(i)) indices[k++] = i;
+			}
+		});
+		return indices;
+	}
+}
@@ -1,6 +1,7 @@
 #include "Pressure.h"
 
 #include "BiLerp.h"
+#include "Tracer.h"
 
 #include <amgcl/amg.hpp>
 #include <amgcl/backend/eigen.hpp>
@@ -11,17 +12,32 @@
 
 namespace Pivot {
 Pressure::Pressure(StaggeredGrid const &sgrid)
-    : m_Grid2Mat(sgrid.GetCellGrid()) {}
+    : m_Grid2Mat(sgrid.GetCellGrid(), -1) {}
 
 void Pressure::Project(SGridData<double> &velocity,
                        GridData<double> const &levelSet,
-                       Collider const &collider, double volError) {
-    SetUnKnowns(levelSet);
-    if (m_Mat2Grid.empty())
-        return;
-    BuildProjectionMatrix(velocity, levelSet, collider, volError);
-    SolveLinearSystem();
-    ApplyProjection(velocity, levelSet, collider);
+                       Collider const &collider, ActiveSet const &active,
+                       double volError) {
+    Tracer::Scope trace("pressure");
+    {
+        Tracer::Scope trace("build");
+        SetUnKnowns(active);
+        if (m_Mat2Grid.empty()) { // there are no fluid faces either
+            m_NumIterations = 0;
+            m_Residual = 0;
+            m_MaxAbsVelocity = 0;
+            return;
+        }
+        BuildProjectionMatrix(velocity, levelSet, collider, volError);
+    }
+    {
+        Tracer::Scope trace("solve");
+        SolveLinearSystem();
+    }
+    {
+        Tracer::Scope trace("apply");
+        ApplyProjection(velocity, levelSet, collider, active);
+    }
 }
 
 void Pressure::BuildProjectionMatrix(SGridData<double> const &velocity,
@@ -69,18 +85,15 @@ void Pressure::BuildProjectionMatrix(SGridData<double> const &velocity,
     m_MatL.setFromTriplets(elements.begin(), elements.end());
 }
 
-void Pressure::SetUnKnowns(GridData<double> const &levelSet) {
-    m_Grid2Mat.SetConstant(-1);
-    m_Mat2Grid.clear();
-
-    int n = 0;
+void Pressure::SetUnKnowns(ActiveSet const &active) {
+    // Only the cells of the previous unknowns need to be reset
+    for (auto const index : m_Mat2Grid) {
+        m_Grid2Mat[index] = -1;
+    }
+    m_Mat2Grid = active.GetFluidCells();
 
-    ForEach(levelSet.GetGrid(), [&](Vector2i const &cell) {
-        if (levelSet[cell] <= 0) {
-            m_Grid2Mat[cell] = n++;
-            m_Mat2Grid.push_back(levelSet.GetGrid().IndexOf(cell));
-        }
-    });
+    int const n = static_cast<int>(m_Mat2Grid.size());
+    tbb::parallel_for(0, n, [&](int r) { m_Grid2Mat[m_Mat2Grid[r]] = r; });
 
     m_MatL.resize(n, n);
     m_RdP.resize(n);
@@ -95,43 +108,54 @@ void Pressure::SolveLinearSystem() {
                    amgcl::coarsening::smoothed_aggregation,
                    amgcl::relaxation::spai0>,
         amgcl::solver::bicgstab<amgcl::backend::eigen<double>>>;
-    Solver solve(m_MatL);
+    Solver::params prm;
+    prm.solver.tol = m_Tolerance;
+    prm.solver.maxiter = m_MaxIterations;
+    Solver solve(m_MatL, prm);
     auto const [iters, error] = solve(m_Rhs, m_RdP);
-    // std::cout << fmt::format("{:>6} iters", iters);
+    m_NumIterations = static_cast<int>(iters);
+    m_Residual = error;
 }
 
 void Pressure::ApplyProjection(SGridData<double> &velocity,
                                GridData<double> const &levelSet,
-                               Collider const &collider) {
-    ParallelForEach(velocity.GetGrids(), [&](int axis, Vector2i const &face) {
-        Vector2i const cell0 = StaggeredGrid::AdjCellOfFace(axis, face, 0);
-        Vector2i const cell1 = StaggeredGrid::AdjCellOfFace(axis, face, 1);
-        double const weight = 1. - collider.GetFraction()[axis][face];
-        if (weight == 0.)
-            return;
-
-        int const id0 = m_Grid2Mat[cell0];
-        int const id1 = m_Grid2Mat[cell1];
-        if (id0 < 0 && id1 < 0)
-            return;
-
-        if (id0 >= 0 && id1 >= 0) {
-            velocity[axis][face] -= (m_RdP[id1] - m_RdP[id0]) * weight;
-        } else {
-            double const phi0 = levelSet[cell0];
-            double const phi1 = levelSet[cell1];
-            double const theta = phi0 / (phi0 - phi1);
+                               Collider const &collider,
+                               ActiveSet const &active) {
+    tbb::combinable<double> maxAbsVelocity(0.);
+    for (int axis = 0; axis < 2; axis++) {
+        auto const &faces = active.GetFluidFaces(axis);
+        Grid const &grid = velocity[axis].GetGrid();
+        ParallelFor(static_cast<int>(faces.size()), { .Kernel = "pressure.apply" }, [&](int begin, int end) {
+            for (int k = begin; k < end; k++) {
+                Vector2i const face = grid.CoordOf(faces[k]);
+                Vector2i const cell0 = StaggeredGrid::AdjCellOfFace(axis, face, 0);
+                Vector2i const cell1 = StaggeredGrid::AdjCellOfFace(axis, face, 1);
+                double const weight = 1. - collider.GetFraction()[axis][face];
+
+                int const id0 = m_Grid2Mat[cell0];
+                int const id1 = m_Grid2Mat[cell1];
+
+                if (id0 >= 0 && id1 >= 0) {
+                    velocity[axis][face] -= (m_RdP[id1] - m_RdP[id0]) * weight;
+                } else {
+                    double const phi0 = levelSet[cell0];
+                    double const phi1 = levelSet[cell1];
+                    double const theta = phi0 / (phi0 - phi1);
 
-            double const pInner = id0 >= 0 ? m_RdP[id0] : m_RdP[id1];
-            double const pIntf =
-                m_PressureJump ? m_PressureJump(axis, face, theta) : 0.;
+                    double const pInner = id0 >= 0 ? m_RdP[id0] : m_RdP[id1];
+                    double const pIntf =
+                        m_PressureJump ? m_PressureJump(axis, face, theta) : 0.;
 
-            double const intfCoef =
-                1. / std::max((id0 >= 0 ? theta : 1 - theta), .001);
+                    double const intfCoef =
+                        1. / std::max((id0 >= 0 ? theta : 1 - theta), .001);
 
-            velocity[axis][face] -=
-                (id0 >= 0 ? +1 : -1) * (pIntf - pInner) * intfCoef * weight;
-        }
-    });
+                    velocity[axis][face] -=
+                        (id0 >= 0 ? +1 : -1) * (pIntf - pInner) * intfCoef * weight;
+                }
+                maxAbsVelocity.local() = std::max(maxAbsVelocity.local(), std::abs(velocity[axis][face]));
+            }
+        });
+    }
+    m_MaxAbsVelocity = maxAbsVelocity.combine([](double lhs, double rhs) { return std::max(lhs, rhs); });
 }
 } // namespace Pivot
@@ -1,14 +1,27 @@
 #pragma once
 
-#include "Collider.h"
+#include "ActiveSet.h"
 
 namespace Pivot {
 class Pressure {
   public:
     explicit Pressure(StaggeredGrid const &sgrid);
 
+    // The active set must be built from the same level set.
     void Project(SGridData<double> &velocity, GridData<double> const &levelSet,
-                 Collider const &collider, double volError = 0);
+                 Collider const &collider, ActiveSet const &active,
+                 double volError = 0);
+
+    int GetNumUnknowns() const { return static_cast<int>(m_Mat2Grid.size()); }
+    int GetNumIterations() const { return m_NumIterations; }
+    double GetResidual() const { return m_Residual; }
+    // Largest velocity component on the fluid faces after the last projection
+    double GetMaxAbsVelocity() const { return m_MaxAbsVelocity; }
+
+    void SetTolerance(double tolerance) { m_Tolerance = tolerance; }
+    void SetMaxIterations(int maxIterations) {
+        m_MaxIterations = maxIterations;
+    }
 
     template <typename Func>
         requires(std::is_convertible_v<
@@ -22,13 +35,13 @@ class Pressure {
                                GridData<double> const &levelSet,
                                Collider const &collider, double volError = 0);
 
-    void SetUnKnowns(GridData<double> const &levelSet);
+    void SetUnKnowns(ActiveSet const &active);
 
     void SolveLinearSystem();
 
     void ApplyProjection(SGridData<double> &velocity,
                          GridData<double> const &levelSet,
-                         Collider const &collider);
+                         Collider const &collider, ActiveSet const &active);
 
   private:
     GridData<int> m_Grid2Mat;
@@ -39,6 +52,13 @@ class Pressure {
     VectorXd m_RdP; // reduced pressure
     VectorXd m_Rhs;
 
+    double m_Tolerance = 1e-8; // relative residual
+    int m_MaxIterations = 100;
+
+    int m_NumIterations = 0; // statistics of the last solve
+    double m_Residual = 0;
+    double m_MaxAbsVelocity = 0;
+
     // Pressure jump: p_liquid - p_air
     std::function<double(int, Vector2i const &, double)> m_PressureJump =
         nullptr;
@@ -0,0 +1,32 @@
+#include "Random.h"
+
+namespace Pivot {
+	void AliasTable::Build(std::span<double const> weights) {
+		int const n = static_cast<int>(weights.size());
+		double sum = 0;
+		for (auto const weight : weights) sum += weight;
+		m_Probs.resize(n);
+		m_Aliases.resize(n);
+		std::vector<int> small, large;
+		for (int i = 0; i < n; i++) {
+			m_Probs[i] = weights[i] * n / sum;
+			m_Aliases[i] = i;
+			(m_Probs[i] < 1 ? small : large).push_back(i);
+		}
+		// Each small column is filled up to one by a large one, which may become small in turn
+		while (!small.empty() && !large.empty()) {
+			int const less = small.back();
+			int const more = large.back();
+			small.pop_back();
+			m_Aliases[less] = more;
+			m_Probs[more] -= 1 - m_Probs[less];
+			if (m_Probs[more] < 1) {
+				large.pop_back();
+				small.push_back(more);
+			}
+		}
+		// What is left is one up to rounding
+		for (auto const i : large) m_Probs[i] = 1;
+		for (auto const i : small) m_Probs[i] = 1;
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Common.h"
+
+namespace Pivot {
+	// The Philox4x32-10 counter-based generator of Salmon et al. Its output is a pure function of the key and the
+	// counter, so a parallel loop that derives the counter from what it computes (a vertex, a sample) draws the same
+	// numbers however it is split among threads.
+	class Philox {
+	public:
+		using Counter = std::array<std::uint32_t, 4>;
+		using Key     = std::array<std::uint32_t, 2>;
+
+		static Counter Generate(Counter counter, Key key) {
+			for (int round = 0; round < 10; round++) {
+				if (round > 0) {
+					key[0] += 0x9E3779B9;
+					key[1] += 0xBB67AE85;
+				}
+				std::uint64_t const product0 = std::uint64_t(0xD2511F53) * counter[0];
+				std::uint64_t const product1 = std::uint64_t(0xCD9E8D57) * counter[2];
+				counter = {
+					std::uint32_t(product1 >> 32) ^ counter[1] ^ key[0], std::uint32_t(product1),
+					std::uint32_t(product0 >> 32) ^ counter[3] ^ key[1], std::uint32_t(product0),
+				};
+			}
+			return counter;
+		}
+	};
+
+	// Draws the numbers of the stream named by a seed and three counter words in order, counting the blocks drawn in
+	// the last word.
+	class RandomStream {
+	public:
+		RandomStream(std::uint64_t seed, std::uint32_t word0, std::uint32_t word1, std::uint32_t word2) :
+			m_Counter { word0, word1, word2, 0 },
+			m_Key { std::uint32_t(seed), std::uint32_t(seed >> 32) } {
+		}
+
+		std::uint32_t NextUInt() {
+			if (m_Next == 4) {
+				m_Block = Philox::Generate(m_Counter, m_Key);
+				m_Counter[3]++;
+				m_Next = 0;
+			}
+			return m_Block[m_Next++];
+		}
+
+		// Returns a uniform number in [0, 1) with 53 random bits.
+		double NextDouble() {
+			std::uint64_t const bits = (std::uint64_t(NextUInt()) << 21) ^ (NextUInt() >> 11);
+			return bits * 0x1p-53;
+		}
+
+	private:
+		Philox::Counter m_Counter;
+		Philox::Key     m_Key;
+		Philox::Counter m_Block;
+		int             m_Next = 4;
+	};
+
+	// Samples indices in proportion to their weights in constant time with the alias method of Walker, built by the
+	// algorithm of Vose in linear time.
+	class AliasTable {
+	public:
+		void Build(std::span<double const> weights);
+
+		int Sample(double u) const {
+			double const x = u * m_Probs.size();
+			int const index = std::min(static_cast<int>(x), static_cast<int>(m_Probs.size()) - 1);
+			return x - index < m_Probs[index] ? index : m_Aliases[index];
+		}
+
+		int size() const { return static_cast<int>(m_Probs.size()); }
+
+	private:
+		std::vector<double> m_Probs;
+		std::vector<int>    m_Aliases;
+	};
+}
@@ -13,13 +13,27 @@ namespace Pivot {
 	}
 
 	void Reinitialization::Solve(GridData<double> &phi, int maxSteps) {
+		Grid const &grid = phi.GetGrid();
+		auto const candidates = ParallelFilter(grid.GetNumVertices(), [&](int index) {
+			Vector2i const coord = grid.CoordOf(index);
+			for (int i = 0; i < Grid::GetNumNeighbors(); i++) {
+				Vector2i const nbCoord = Grid::NeighborOf(coord, i);
+				if (grid.IsValid(nbCoord) && phi[coord] * phi[nbCoord] <= 0) return true;
+			}
+			return false;
+		});
+		Solve(phi, maxSteps, candidates);
+	}
+
+	void Reinitialization::Solve(GridData<double> &phi, int maxSteps, std::span<int const> intfCandidates) {
 		double const bandWidth = maxSteps * phi.GetGrid().GetSpacing();
 		GridData<std::int8_t> visited(phi.GetGrid());
 		GridData<double> tent(phi.GetGrid(), bandWidth > 0 ? bandWidth : std::numeric_limits<double>::infinity());
 		std::vector<int> intfIndices;
 		Heap heap;
 		// Initialize interface cells
-		ForEach(phi.GetGrid(), [&](Vector2i const &coord) {
+		for (auto const candidate : intfCandidates) {
+			Vector2i const coord = phi.GetGrid().CoordOf(candidate);
 			Vector2d tempPhi = Vector2d::Ones() * std::numeric_limits<double>::infinity();
 			for (int i = 0; i < Grid::GetNumNeighbors(); i++) {
 				Vector2i nbCoord = Grid::NeighborOf(coord, i);
@@ -31,9 +45,9 @@ namespace Pivot {
 			if (tempPhi.array().isFinite().any()) {
 				tent[coord] = 1. / tempPhi.cwiseInverse().norm();
 				visited[coord] = true;
-				intfIndices.push_back(phi.GetGrid().IndexOf(coord));
+				intfIndices.push_back(candidate);
 			}
-		});
+		}
 		// Perform the algorithm
 		for (auto const index : intfIndices) {
 			UpdateNeighbors(tent.GetGrid().CoordOf(index), visited, tent, heap);
@@ -48,7 +62,41 @@ namespace Pivot {
 		}
 		ParallelForEach(phi.GetGrid(), [&](Vector2i const &coord) {
 			phi[coord] = (phi[coord] <= 0 ? -1 : 1) * tent[coord];
+		}, { .Kind = Partitioner::Static, .Grain = 1024 });
+	}
+
+	void Reinitialization::Solve(GridData<double> &phi, int maxSteps, SurfaceMesh const &contour) {
+		Grid const &grid = phi.GetGrid();
+		double const bandWidth = maxSteps * grid.GetSpacing();
+		if (bandWidth <= 0) {
+			ParallelForEach(grid, [&](Vector2i const &coord) {
+				double const dist = std::sqrt(contour.FindClosest(grid.PositionOf(coord)).SquaredDistance);
+				phi[coord] = (phi[coord] <= 0 ? -1 : 1) * dist;
+			});
+			return;
+		}
+		GridData<double> dist(grid, bandWidth);
+		tbb::parallel_for(std::size_t(0), contour.Indices.size() / 2, [&](std::size_t j) {
+			Vector2d const a = contour.Positions[contour.Indices[2 * j]];
+			Vector2d const ab = contour.Positions[contour.Indices[2 * j + 1]] - a;
+			double const squaredLength = ab.squaredNorm();
+			Vector2i const lower = grid.Clamp(grid.CalcLower<1>(a.cwiseMin(a + ab) - Vector2d::Constant(bandWidth)));
+			Vector2i const upper = grid.Clamp(grid.CalcLower<1>(a.cwiseMax(a + ab) + Vector2d::Constant(bandWidth)) + Vector2i::Ones());
+			for (int x = lower.x(); x <= upper.x(); x++) {
+				for (int y = lower.y(); y <= upper.y(); y++) {
+					Vector2d const pos = grid.PositionOf({ x, y });
+					double const fraction = squaredLength > 0 ? std::clamp((pos - a).dot(ab) / squaredLength, 0., 1.) : 0.;
+					double const newDist = (a + fraction * ab - pos).norm();
+					// Segments sharing a cell take the smallest distance in any order
+					std::atomic_ref<double> cellDist(dist[{ x, y }]);
+					double oldDist = cellDist.load(std::memory_order_relaxed);
+					while (newDist < oldDist && !cellDist.compare_exchange_weak(oldDist, newDist, std::memory_order_relaxed));
+				}
+			}
 		});
+		ParallelForEach(grid, [&](Vector2i const &coord) {
+			phi[coord] = (phi[coord] <= 0 ? -1 : 1) * dist[coord];
+		}, { .Kind = Partitioner::Static, .Grain = 1024 });
 	}
 
 	void Reinitialization::UpdateNeighbors(Vector2i const &coord, GridData<std::int8_t> const &visited, GridData<double> &tent, Heap &heap) {
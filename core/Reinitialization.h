@@ -1,6 +1,7 @@
 #pragma once
 
 #include "GridData.h"
+#include "SurfaceMesh.h"
 
 namespace Pivot {
 	class Reinitialization {
@@ -8,8 +9,17 @@ namespace Pivot {
 		using HeapElement = std::pair<double, int>;
 		using Heap = std::priority_queue<HeapElement, std::vector<HeapElement>, std::greater<HeapElement>>;
 
+	public:
+		enum class Method { FastMarching, Geometric };
+
 	public:
 		static void Solve(GridData<double> &phi, int maxSteps);
+		// Only the listed cells are checked for the interface; they must include every cell next to a sign change.
+		static void Solve(GridData<double> &phi, int maxSteps, std::span<int const> intfCandidates);
+		// Takes the exact distances to the segments of the contour of phi, rasterizing every segment over the cells of
+		// the band around it in parallel, with the sign of phi. Without a band, every cell queries the mesh instead, through the
+		// query grid Contour::Generate builds.
+		static void Solve(GridData<double> &phi, int maxSteps, SurfaceMesh const &contour);
 	
 	private:
 		static void   UpdateNeighbors     (Vector2i const &coord, GridData<std::int8_t> const &visited, GridData<double>       &tent, Heap &heap);
@@ -0,0 +1,83 @@
+#include "Scheduler.h"
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace Pivot {
+	// Pins each thread entering the arena to one core, chosen by its slot in the arena
+	class PinningObserver : public tbb::task_scheduler_observer {
+	public:
+		PinningObserver(tbb::task_arena &arena, int firstCore) :
+			tbb::task_scheduler_observer(arena) {
+#ifdef __linux__
+			cpu_set_t mask;
+			CPU_ZERO(&mask);
+			sched_getaffinity(0, sizeof(mask), &mask);
+			for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+				if (CPU_ISSET(cpu, &mask)) m_Cores.push_back(cpu);
+			}
+			if (!m_Cores.empty()) {
+				std::rotate(m_Cores.begin(), m_Cores.begin() + firstCore % m_Cores.size(), m_Cores.end());
+			}
+#else
+			spdlog::warn("Thread pinning is not supported on this platform");
+#endif
+			observe(true);
+		}
+
+		~PinningObserver() { observe(false); }
+
+		void on_scheduler_entry(bool) override {
+#ifdef __linux__
+			int const slot = tbb::this_task_arena::current_thread_index();
+			if (m_Cores.empty() || slot < 0) return;
+			cpu_set_t mask;
+			CPU_ZERO(&mask);
+			CPU_SET(m_Cores[slot % m_Cores.size()], &mask);
+			sched_setaffinity(0, sizeof(mask), &mask);
+#endif
+		}
+
+	private:
+		std::vector<int> m_Cores;
+	};
+
+	static std::unique_ptr<tbb::global_control> s_Control;
+	static std::unique_ptr<tbb::task_arena>     s_Arena;
+	static std::unique_ptr<PinningObserver>     s_Observer;
+
+	void Scheduler::Initialize(SchedulerOptions const &options) {
+		s_Observer.reset();
+		s_Arena.reset();
+		s_Control.reset();
+
+		int numThreads = options.NumThreads > 0 ? options.NumThreads : tbb::info::default_concurrency();
+		tbb::task_arena::constraints constraints;
+		if (options.NumaNode >= 0) {
+			auto const nodes = tbb::info::numa_nodes();
+			if (std::find(nodes.begin(), nodes.end(), options.NumaNode) != nodes.end()) {
+				constraints.numa_id = options.NumaNode;
+				numThreads = std::min(numThreads, tbb::info::default_concurrency(options.NumaNode));
+			} else {
+				spdlog::warn("NUMA node {} is not available, ignoring it", options.NumaNode);
+			}
+		}
+		constraints.max_concurrency = numThreads;
+
+		// Also caps loops issued outside the arena, so that no other pool competes for the cores
+		s_Control = std::make_unique<tbb::global_control>(tbb::global_control::max_allowed_parallelism, numThreads);
+		s_Arena = std::make_unique<tbb::task_arena>(constraints);
+		s_Arena->initialize();
+		if (options.Pinned) {
+			s_Observer = std::make_unique<PinningObserver>(*s_Arena, options.FirstCore);
+		}
+	}
+
+	tbb::task_arena &Scheduler::GetArena() {
+		if (!s_Arena) {
+			Initialize({ });
+		}
+		return *s_Arena;
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Common.h"
+
+namespace Pivot {
+	struct SchedulerOptions {
+		int  NumThreads = 0;  // zero for all available cores
+		bool Pinned     = false;
+		int  FirstCore  = 0;  // offset into the allowed cores when pinned, to pack several processes on one node
+		int  NumaNode   = -1; // restrict to one NUMA node, negative for no restriction
+	};
+
+	// Owns the task arena every parallel loop runs in. Loops issued inside Execute share its workers, so the
+	// whole program never uses more threads than configured.
+	class Scheduler {
+	public:
+		static void Initialize(SchedulerOptions const &options);
+
+		static int GetNumThreads() { return GetArena().max_concurrency(); }
+
+		template <typename Func>
+		static decltype(auto) Execute(Func &&func) { return GetArena().execute(std::forward<Func>(func)); }
+
+	private:
+		static tbb::task_arena &GetArena();
+	};
+}
@@ -5,13 +5,16 @@
 #include "CSG.h"
 #include "Extrapolation.h"
 #include "FiniteDiff.h"
+#include "GridSnapshot.h"
 #include "Image.h"
 #include "Reinitialization.h"
+#include "Tracer.h"
 
 namespace Pivot {
 Simulation::Simulation(StaggeredGrid const &sgrid)
     : m_SGrid{sgrid}, m_Collider(m_SGrid), m_Pressure(m_SGrid),
       m_Velocity(m_SGrid.GetFaceGrids()),
+      m_Active(m_SGrid),
       m_LevelSet(m_SGrid.GetCellGrid(),
                  std::numeric_limits<double>::infinity()),
       m_Contour(m_SGrid.GetCellGrid()) {}
@@ -32,8 +35,62 @@ void Simulation::Export(std::filesystem::path const &filename) const {
     }
 }
 
+void Simulation::Export(
+    FrameWriter &writer,
+    std::optional<FrameArchive::Encoding> fieldEncoding) const {
+    std::span<double const> magneticPressure;
+    if (m_MagneticEnabled) {
+        magneticPressure = m_Magnetic.m_MagneticPressure;
+    }
+    writer.WriteMesh(m_Contour.GetMesh(), magneticPressure);
+    if (fieldEncoding) {
+        writer.WriteField("levelset", m_LevelSet, *fieldEncoding);
+        writer.WriteField("velocity.x", m_Velocity[0], *fieldEncoding);
+        writer.WriteField("velocity.y", m_Velocity[1], *fieldEncoding);
+    }
+}
+
+void Simulation::SaveSnapshot(std::filesystem::path const &dirname) const {
+    std::filesystem::create_directories(dirname);
+    GridSnapshot::Save(dirname / "levelset.pgs", m_LevelSet);
+    GridSnapshot::Save(dirname / "velocity.x.pgs", m_Velocity[0]);
+    GridSnapshot::Save(dirname / "velocity.y.pgs", m_Velocity[1]);
+    YAML::Node state;
+    state["time"] = m_Time;
+    state["init_volume"] = m_InitVolume;
+    state["cumul_vol_error"] = m_CumulVolError;
+    // Names the random streams of the next Monte Carlo solve
+    state["magnetic_solves"] = m_Magnetic.m_NumSolves;
+    std::ofstream(dirname / "state.yaml") << state;
+}
+
+void Simulation::LoadSnapshot(std::filesystem::path const &dirname) {
+    GridDataView<double>(dirname / "levelset.pgs").CopyTo(m_LevelSet);
+    GridDataView<double>(dirname / "velocity.x.pgs").CopyTo(m_Velocity[0]);
+    GridDataView<double>(dirname / "velocity.y.pgs").CopyTo(m_Velocity[1]);
+    m_MaxAbsVelocity.reset();
+    try {
+        auto const state = YAML::LoadFile((dirname / "state.yaml").string());
+        m_Time = state["time"].as<double>();
+        m_InitVolume = state["init_volume"].as<double>();
+        m_CumulVolError = state["cumul_vol_error"].as<double>();
+        m_Magnetic.m_NumSolves = state["magnetic_solves"].as<std::uint32_t>(
+            m_Magnetic.m_NumSolves);
+    } catch (YAML::Exception const &e) {
+        spdlog::critical("Failed to load snapshot state: {}", e.what());
+        std::exit(EXIT_FAILURE);
+    }
+    m_Collider.MoveBodies(m_Time);
+    // The level set was saved reinitialized at the end of a substep, so it is
+    // restored as is and only the quantities derived from it are rebuilt. The
+    // magnetic pressure is solved again at the start of the next substep.
+    m_Active.Build(m_LevelSet, m_Collider);
+    UpdateContour();
+}
+
 void Simulation::Initialize() {
-    m_Collider.Finish(m_SGrid);
+    Tracer::Scope trace("initialize");
+    m_Collider.Finish();
     CSG::Intersect(m_LevelSet, m_Collider.GetDomainBox());
 
     ReinitializeLevelSet(true);
@@ -43,28 +100,91 @@ void Simulation::Initialize() {
 }
 
 void Simulation::Advance(double deltaTime) {
-    AdvectFields(deltaTime);
-    ApplyBodyForces(deltaTime);
-    ApplySurfacePressure(deltaTime);
-    ProjectVelocity(deltaTime);
+    Tracer::Scope trace("advance");
+    using Clock = std::chrono::steady_clock;
+    auto const timeOf = [](auto &&func) {
+        auto const beginTime = Clock::now();
+        func();
+        return std::chrono::duration<double>(Clock::now() - beginTime).count();
+    };
+    if (m_Collider.HasBodies()) {
+        // The fields are advanced and projected against the solid at the end
+        // of the substep
+        Tracer::Scope trace("move collider");
+        m_Collider.MoveBodies(m_Time + deltaTime);
+    }
+    m_Metrics.AdvectTime = timeOf([&] { AdvectFields(deltaTime); });
+    m_Metrics.SurfacePressureTime =
+        timeOf([&] { ApplySurfacePressure(deltaTime); });
+    m_Metrics.ProjectTime = timeOf([&] { ProjectVelocity(deltaTime); });
+
+    m_Metrics.DeltaTime = deltaTime;
+    m_Metrics.NumFluidCells = m_Pressure.GetNumUnknowns();
+    m_Metrics.NumContourVertices =
+        static_cast<int>(m_Contour.GetMesh().Positions.size());
+    m_Metrics.NumContourComponents =
+        static_cast<int>(m_Contour.GetMesh().Components.size());
+    m_Metrics.PressureIterations = m_Pressure.GetNumIterations();
+    m_Metrics.PressureResidual = m_Pressure.GetResidual();
+    m_Metrics.MagneticIterations =
+        m_MagneticEnabled ? m_Magnetic.m_NumIterations : 0;
+    m_Metrics.MagneticResidualL1 =
+        m_MagneticEnabled ? m_Magnetic.m_ResidualL1 : 0;
+    m_Metrics.MagneticResidualMax =
+        m_MagneticEnabled ? m_Magnetic.m_ResidualMax : 0;
+    m_Metrics.MagneticStdError =
+        m_MagneticEnabled ? m_Magnetic.m_MaxStdError : 0;
+    m_Metrics.MagneticVertices =
+        m_MagneticEnabled ? m_Magnetic.m_NumVertices : 0;
+    m_Metrics.MagneticResampleError =
+        m_MagneticEnabled ? m_Magnetic.m_ResampleError : 0;
 }
 
 void Simulation::AdvectFields(double dt) {
-    Advection::Solve<2>(m_LevelSet, m_Velocity, dt);
-    Advection::Solve<2>(m_Velocity, m_Velocity, dt);
+    {
+        Tracer::Scope trace("advect");
+        Advection::Solve<2>(m_LevelSet, m_Velocity, dt, m_AdvectionScheme);
+        // Body forces are added in the same sweep
+        Advection::Solve<2>(m_Velocity, m_Velocity, dt,
+                            Vector2d(GetBodyAcceleration() * dt),
+                            m_AdvectionScheme);
+    }
+    m_MaxAbsVelocity.reset();
 
     ReinitializeLevelSet();
 }
 
-void Simulation::ApplyBodyForces(double dt) {
-    if (m_GravityEnabled) {
-        ParallelForEach(m_Velocity[1].GetGrid(), [&](Vector2i const &face) {
-            m_Velocity[1][face] -= 9.8 * dt;
-        });
+double Simulation::GetCapillaryTimeStep() const {
+    if (!m_SurfaceTensionEnabled) {
+        return std::numeric_limits<double>::infinity();
     }
+    double const dx = m_SGrid.GetSpacing();
+    return std::sqrt(m_LiquidDensity * dx * dx * dx /
+                     (2 * std::numbers::pi * m_SurfaceTensionCoeff));
+}
+
+double Simulation::GetMagneticTimeStep() const {
+    // Like the capillary limit with the magnetic pressure in place of
+    // sigma / dx: the velocity the pressure jump adds in one step must not
+    // carry the interface further than a cell.
+    double maxPressure = 0;
+    if (m_MagneticEnabled) {
+        for (auto const pressure : m_Magnetic.m_MagneticPressure) {
+            maxPressure = std::max(maxPressure, std::abs(pressure));
+        }
+    }
+    if (maxPressure == 0) {
+        return std::numeric_limits<double>::infinity();
+    }
+    return m_SGrid.GetSpacing() * std::sqrt(m_LiquidDensity / maxPressure);
+}
+
+Vector2d Simulation::GetBodyAcceleration() const {
+    return m_GravityEnabled ? m_Gravity : Vector2d::Zero();
 }
 
 void Simulation::ApplySurfacePressure(double dt) {
+    Tracer::Scope trace("surface pressure");
     if (m_MagneticEnabled) {
         m_Magnetic.Solve(m_Contour.GetMesh());
     }
@@ -90,40 +210,116 @@ void Simulation::ApplySurfacePressure(double dt) {
 }
 
 void Simulation::ProjectVelocity(double dt) {
+    Tracer::Scope trace("project");
     double x = (m_CurrentVolume - m_InitVolume) / (m_InitVolume);
     m_CumulVolError += x * dt;
     double kp = 0.1 / dt;
     double ki = kp * kp / 16;
     double c = 1 / (x + 1) * (-kp * x - ki * m_CumulVolError);
-    m_Pressure.Project(m_Velocity, m_LevelSet, m_Collider,
+    m_Pressure.Project(m_Velocity, m_LevelSet, m_Collider, m_Active,
                        c * m_SGrid.GetSpacing());
     // m_Pressure.Project(m_Velocity, m_LevelSet, m_Collider);
-    Extrapolation::Solve(
-        m_Velocity, 0., 6, [&](int axis, Vector2i const &face) {
-            Vector2i const cell0 = StaggeredGrid::AdjCellOfFace(axis, face, 0);
-            Vector2i const cell1 = StaggeredGrid::AdjCellOfFace(axis, face, 1);
-            return m_Collider.GetFraction()[axis][face] < 1 &&
-                   (m_LevelSet[cell0] <= 0 || m_LevelSet[cell1] <= 0);
-        });
-    m_Collider.Enforce(m_Velocity);
+    {
+        Tracer::Scope trace("extrapolate");
+        Extrapolation::Solve(
+            m_Velocity, 0., m_ExtrapolationSteps,
+            m_Active.GetFluidFaceMask(),
+            {m_Active.GetFluidFaces(0), m_Active.GetFluidFaces(1)});
+    }
+    {
+        Tracer::Scope trace("enforce collider");
+        double const maxEnforced = m_Collider.Enforce(m_Velocity);
+        // Extrapolated values are averages of fluid ones and the rest are
+        // cleared, so the fluid and the enforced faces bound the velocity
+        m_MaxAbsVelocity =
+            std::max(m_Pressure.GetMaxAbsVelocity(), maxEnforced);
+    }
+}
+
+double Simulation::GetMaxAbsVelocity() const {
+    if (!m_MaxAbsVelocity) {
+        m_MaxAbsVelocity = m_Velocity.GetMaxAbsComponent();
+    }
+    return *m_MaxAbsVelocity;
 }
 
 void Simulation::ReinitializeLevelSet(bool initial) {
-    Extrapolation::Solve(
-        m_LevelSet, 1.5 * m_SGrid.GetSpacing(), 1,
-        [&](Vector2i const &cell) { return !m_Collider.IsInside(cell); });
-    Reinitialization::Solve(m_LevelSet, 5);
+    {
+        Tracer::Scope trace("extrapolate");
+        Extrapolation::Solve(
+            m_LevelSet, 1.5 * m_SGrid.GetSpacing(), 1,
+            [&](Vector2i const &cell) { return !m_Collider.IsInside(cell); });
+    }
+    {
+        Tracer::Scope trace("active set");
+        m_Active.Build(m_LevelSet, m_Collider);
+    }
+    {
+        Tracer::Scope trace("reinit");
+        if (m_ReinitMethod == Reinitialization::Method::Geometric) {
+            // From the contour of the level set itself, which UpdateContour
+            // replaces with the one of the liquid outside the collider
+            m_Contour.Generate(m_LevelSet);
+            Reinitialization::Solve(m_LevelSet, m_ReinitSteps,
+                                    m_Contour.GetMesh());
+        } else {
+            Reinitialization::Solve(m_LevelSet, m_ReinitSteps,
+                                    m_Active.GetInterfaceCells());
+        }
+    }
+    UpdateContour();
+    if (initial) {
+        m_InitVolume = m_CurrentVolume;
+    }
+    m_Metrics.Volume = m_CurrentVolume;
+    m_Metrics.VolumeError = (m_CurrentVolume - m_InitVolume) / m_InitVolume;
+}
 
+void Simulation::UpdateContour() {
     auto opLevelSet = m_LevelSet;
     CSG::Except(opLevelSet, m_Collider.GetAuxLevelSet());
-    m_Contour.Generate(opLevelSet);
-    // m_Contour.ComputeVertexInfos();
-    m_Contour.ComputeVertexInfosFromLS(opLevelSet);
-    m_Contour.ComputeVolumeFromLS(opLevelSet);
+    {
+        Tracer::Scope trace("contour");
+        m_Contour.Generate(opLevelSet);
+    }
+    {
+        Tracer::Scope trace("areas/curvature");
+        // m_Contour.ComputeVertexInfos();
+        m_Contour.ComputeVertexInfosFromLS(opLevelSet);
+    }
+    {
+        Tracer::Scope trace("volume");
+        m_Contour.ComputeVolumeFromLS(opLevelSet);
+    }
     m_CurrentVolume = m_Contour.GetMesh().TotalVolume;
-    if (initial) {
-        m_InitVolume = m_CurrentVolume;
+}
+
+void Simulation::SaveCheckpoint() {
+    if (m_Checkpoint) {
+        m_Checkpoint->LevelSet = m_LevelSet;
+        m_Checkpoint->Velocity = m_Velocity;
+    } else {
+        m_Checkpoint = std::make_unique<Checkpoint>(
+            Checkpoint{m_LevelSet, m_Velocity});
     }
-    fmt::print("volume {:.3e}/{:.3e} ", m_CurrentVolume, m_InitVolume);
+    m_Checkpoint->Time = m_Time;
+    m_Checkpoint->CurrentVolume = m_CurrentVolume;
+    m_Checkpoint->CumulVolError = m_CumulVolError;
+}
+
+void Simulation::RestoreCheckpoint() {
+    m_LevelSet = m_Checkpoint->LevelSet;
+    m_Velocity = m_Checkpoint->Velocity;
+    m_MaxAbsVelocity.reset();
+    m_Time = m_Checkpoint->Time;
+    m_CumulVolError = m_Checkpoint->CumulVolError;
+    m_Collider.MoveBodies(m_Time);
+    // The level set is already reinitialized, so only the derived data is
+    // rebuilt
+    m_Active.Build(m_LevelSet, m_Collider);
+    UpdateContour();
+    m_CurrentVolume = m_Checkpoint->CurrentVolume;
+    m_Metrics.Volume = m_CurrentVolume;
+    m_Metrics.VolumeError = (m_CurrentVolume - m_InitVolume) / m_InitVolume;
 }
 } // namespace Pivot
@@ -1,9 +1,13 @@
 #pragma once
 
+#include "Advection.h"
 #include "Collider.h"
 #include "Contour.h"
+#include "FrameArchive.h"
 #include "Magnetic.h"
 #include "Pressure.h"
+#include "Reinitialization.h"
+#include "Telemetry.h"
 
 namespace Pivot {
 class Simulation {
@@ -17,26 +21,57 @@ class Simulation {
     explicit Simulation(StaggeredGrid const &sgrid);
 
     void Export(std::filesystem::path const &filename) const;
+    void Export(FrameWriter &writer,
+                std::optional<FrameArchive::Encoding> fieldEncoding) const;
+
+    void SaveSnapshot(std::filesystem::path const &dirname) const;
+    void LoadSnapshot(std::filesystem::path const &dirname);
 
     void Initialize();
     void Advance(double deltaTime);
 
     void AdvectFields(double dt);
-    void ApplyBodyForces(double dt);
     void ApplySurfacePressure(double dt);
     void ProjectVelocity(double dt);
 
     void ReinitializeLevelSet(bool initial = false);
 
+    // Keeps a copy of the state to return to when a substep is rejected.
+    void SaveCheckpoint();
+    void RestoreCheckpoint();
+
+    SubstepMetrics const &GetMetrics() const { return m_Metrics; }
+
     void SetTime(double time) { m_Time = time; }
     auto GetTime() const { return m_Time; }
 
+    Vector2d GetBodyAcceleration() const;
+
+    // Moving bodies count from the start, as their speed only reaches the
+    // velocity field through the projection after they have moved
     double GetCourantTimeStep() const {
-        return m_SGrid.GetSpacing() / m_Velocity.GetMaxAbsComponent();
+        return m_SGrid.GetSpacing() /
+               std::max(GetMaxAbsVelocity(), m_Collider.GetMaxBodySpeed());
     }
+    // Cached by the projection, or reduced over the faces if the velocity
+    // changed since
+    double GetMaxAbsVelocity() const;
+    double GetCapillaryTimeStep() const;
+    double GetMagneticTimeStep() const;
 
   private:
-    double m_Time;
+    struct Checkpoint {
+        GridData<double> LevelSet;
+        SGridData<double> Velocity;
+        double Time = 0;
+        double CurrentVolume = 0;
+        double CumulVolError = 0;
+    };
+
+    void UpdateContour();
+
+  private:
+    double m_Time = 0;
     Scene m_Scene;
 
     StaggeredGrid m_SGrid;
@@ -44,14 +79,25 @@ class Simulation {
     Pressure m_Pressure;
     Magnetic m_Magnetic;
     SGridData<double> m_Velocity;
+    mutable std::optional<double> m_MaxAbsVelocity; // empty when stale
+    ActiveSet m_Active; // rebuilt whenever the level set is reinitialized
     GridData<double> m_LevelSet;
     Contour m_Contour;
     double m_InitVolume;
     double m_CurrentVolume;
     double m_CumulVolError = 0;
+    SubstepMetrics m_Metrics;
+    std::unique_ptr<Checkpoint> m_Checkpoint;
 
     double m_LiquidDensity = 1e3;
     double m_SurfaceTensionCoeff = 7.28e-2;
+    Vector2d m_Gravity = Vector2d(0, -9.8);
+
+    Advection::Scheme m_AdvectionScheme = Advection::Scheme::SemiLagrangian;
+    int m_ReinitSteps = 5;
+    Reinitialization::Method m_ReinitMethod =
+        Reinitialization::Method::FastMarching;
+    int m_ExtrapolationSteps = 6; // of the velocity
 
     bool m_GravityEnabled = true;
     bool m_SurfaceTensionEnabled = false;
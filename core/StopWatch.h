@@ -2,6 +2,8 @@
 
 #include "Common.h"
 
+#include <mutex>
+
 namespace Pivot {
 	class StopWatch {
 	private:
@@ -15,6 +17,7 @@ namespace Pivot {
 
 		double Stop() {
 			auto const sec = std::chrono::duration<double>(Clock::now() - m_BeginTime).count();
+			std::lock_guard lock(s_Mutex);
 			if (auto it = s_Stats.find(m_Name); it != s_Stats.end()) {
 				auto const i = it->second;
 				s_AvgTime[i] += (sec - s_AvgTime[i]) / ++s_Counts[i];
@@ -33,6 +36,7 @@ namespace Pivot {
 		std::string m_Name;
 		Clock::time_point m_BeginTime;
 
+		static inline std::mutex                                   s_Mutex;
 		static inline std::unordered_map<std::string, std::size_t> s_Stats;
 		static inline std::vector<std::string>   s_Names;
 		static inline std::vector<std::uint32_t> s_Counts;
@@ -5,6 +5,8 @@ void SurfaceMesh::Clear() {
     Positions.clear();
     Normals.clear();
     Indices.clear();
+    Components.clear();
+    m_QueryGrid.reset();
 }
 
 void SurfaceMesh::Export(std::ostream &out) const {
@@ -19,6 +21,68 @@ void SurfaceMesh::Export(std::ostream &out) const {
     IO::Write(out, Indices);
 }
 
+void SurfaceMesh::BuildComponents(std::vector<std::uint32_t> &newIndices) {
+    constexpr auto none = std::numeric_limits<std::uint32_t>::max();
+    std::uint32_t const numVertices = Positions.size();
+    std::vector<std::uint32_t> next(numVertices, none);
+    std::vector<std::uint8_t> hasPrev(numVertices, 0);
+    for (std::size_t i = 0; i < Indices.size(); i += 2) {
+        next[Indices[i + 0]] = Indices[i + 1];
+        hasPrev[Indices[i + 1]] = 1;
+    }
+
+    Components.clear();
+    newIndices.assign(numVertices, none);
+    std::vector<std::uint32_t> order;
+    order.reserve(numVertices);
+    auto const follow = [&](std::uint32_t first) {
+        Component component{static_cast<std::uint32_t>(order.size())};
+        std::uint32_t i = first;
+        for (; i != none && newIndices[i] == none; i = next[i]) {
+            newIndices[i] = order.size();
+            order.push_back(i);
+        }
+        component.End = order.size();
+        component.Closed = i == first;
+        Components.push_back(component);
+    };
+    for (std::uint32_t i = 0; i < numVertices; i++) {
+        if (!hasPrev[i]) {
+            follow(i);
+        }
+    }
+    for (std::uint32_t i = 0; i < numVertices; i++) {
+        if (newIndices[i] == none) {
+            follow(i);
+        }
+    }
+
+    auto const reorder = [&](auto &values) {
+        if (values.size() != numVertices) {
+            return;
+        }
+        auto const old = values;
+        tbb::parallel_for(std::uint32_t(0), numVertices, [&](std::uint32_t i) {
+            values[i] = old[order[i]];
+        });
+    };
+    reorder(Positions);
+    reorder(Normals);
+    reorder(Areas);
+    reorder(MeanCurvatures);
+    Indices.clear();
+    for (auto const &component : Components) {
+        for (auto i = component.Begin; i + 1 < component.End; i++) {
+            Indices.push_back(i);
+            Indices.push_back(i + 1);
+        }
+        if (component.Closed) {
+            Indices.push_back(component.End - 1);
+            Indices.push_back(component.Begin);
+        }
+    }
+}
+
 void SurfaceMesh::ComputeAreas() {
     TotalArea = 0;
     Areas.resize(Positions.size());
@@ -34,39 +98,425 @@ void SurfaceMesh::ComputeAreas() {
 }
 
 void SurfaceMesh::ComputeVolume() {
+    if (Components.empty() && !Positions.empty()) {
+        spdlog::critical("Failed to compute the volume of a mesh without "
+                         "components");
+        std::exit(EXIT_FAILURE);
+    }
     TotalVolume = 0;
-    for (std::size_t i = 0; i < Indices.size(); i += 2) {
-        auto const i0 = Indices[i + 0];
-        auto const i1 = Indices[i + 1];
-        Vector2d v0 = Positions[i0];
-        Vector2d v1 = Positions[i1];
-        TotalVolume += (v0.x() * v1.y() - v0.y() * v1.x()) / 2;
+    for (auto &component : Components) {
+        component.Volume = 0;
+        auto const last =
+            component.Closed ? component.End : component.End - 1;
+        for (auto i = component.Begin; i < last; i++) {
+            Vector2d v0 = Positions[i];
+            Vector2d v1 = Positions[NextOf(component, i)];
+            component.Volume += (v0.x() * v1.y() - v0.y() * v1.x()) / 2;
+        }
+        TotalVolume += component.Volume;
     }
 }
 
 void SurfaceMesh::ComputeMeanCurvatures() {
+    if (Components.empty() && !Positions.empty()) {
+        spdlog::critical("Failed to compute the curvatures of a mesh without "
+                         "components");
+        std::exit(EXIT_FAILURE);
+    }
     ComputeAreas();
 
-    std::vector<Vector2d> inEdge(Positions.size());
-    std::vector<Vector2d> outEdge(Positions.size());
-    for (std::size_t i = 0; i < Indices.size(); i += 2) {
-        auto const i0 = Indices[i + 0];
-        auto const i1 = Indices[i + 1];
-        Vector2d const vec = Positions[i1] - Positions[i0];
-        inEdge[i1] = vec;
-        outEdge[i0] = vec;
-    }
     MeanCurvatures.resize(Positions.size());
-    tbb::parallel_for(
-        static_cast<std::size_t>(0), Positions.size(), [&](std::size_t i) {
-            double const cosTheta = inEdge[i].dot(outEdge[i]) /
-                                    (inEdge[i].norm() * outEdge[i].norm());
-            int const sign = inEdge[i].x() * outEdge[i].y() -
-                                         inEdge[i].y() * outEdge[i].x() >
-                                     0
-                                 ? +1
-                                 : -1;
-            MeanCurvatures[i] = std::acos(cosTheta) * sign / Areas[i];
+    for (auto const &component : Components) {
+        tbb::parallel_for(
+            component.Begin, component.End, [&](std::uint32_t i) {
+                // Zero at the ends of an open polyline
+                if (!component.Closed &&
+                    (i == component.Begin || i + 1 == component.End)) {
+                    MeanCurvatures[i] = 0;
+                    return;
+                }
+                Vector2d const inEdge =
+                    Positions[i] - Positions[PrevOf(component, i)];
+                Vector2d const outEdge =
+                    Positions[NextOf(component, i)] - Positions[i];
+                double const cosTheta =
+                    inEdge.dot(outEdge) / (inEdge.norm() * outEdge.norm());
+                int const sign =
+                    inEdge.x() * outEdge.y() - inEdge.y() * outEdge.x() > 0
+                        ? +1
+                        : -1;
+                MeanCurvatures[i] = std::acos(cosTheta) * sign / Areas[i];
+            });
+    }
+}
+
+void SurfaceMesh::Resample(double spacing, double maxAngle, SurfaceMesh &coarse,
+                           std::vector<ResampledVertex> &vertices) const {
+    if (Components.empty() && !Positions.empty()) {
+        spdlog::critical("Failed to resample a mesh without components");
+        std::exit(EXIT_FAILURE);
+    }
+    coarse.Clear();
+    vertices.resize(Positions.size());
+
+    std::vector<double> costs;
+    std::vector<double> lengths;
+    std::vector<std::uint32_t> picks;
+    for (auto const &component : Components) {
+        std::uint32_t const begin = component.Begin;
+        int const numVertices = component.End - begin;
+        int const numEdges = component.Closed ? numVertices : numVertices - 1;
+
+        // The cost and the arc length at every vertex, and at the end of a
+        // loop back at its first vertex
+        costs.assign(numVertices + 1, 0);
+        lengths.assign(numVertices + 1, 0);
+        for (int k = 0; k < numEdges; k++) {
+            std::uint32_t const i0 = begin + k;
+            std::uint32_t const i1 = NextOf(component, i0);
+            Vector2d const e0 = Positions[i1] - Positions[i0];
+            double const length = e0.norm();
+            double turn = 0;
+            if (component.Closed || k + 1 < numEdges) {
+                Vector2d const e1 = Positions[NextOf(component, i1)] -
+                                    Positions[i1];
+                turn = std::abs(std::atan2(e0.x() * e1.y() - e0.y() * e1.x(),
+                                           e0.dot(e1)));
+            }
+            lengths[k + 1] = lengths[k] + length;
+            costs[k + 1] = costs[k] + length / spacing + turn / maxAngle;
+        }
+
+        // Evenly in cost, at least a triangle for a loop
+        double const totalCost = costs[numEdges];
+        int const numSegments =
+            std::min(numEdges,
+                     std::max(component.Closed ? 3 : 1,
+                              static_cast<int>(std::lround(totalCost))));
+        picks.assign(1, 0);
+        for (int k = 1; k < numEdges; k++) {
+            if (costs[k] * numSegments >=
+                totalCost * static_cast<double>(picks.size())) {
+                picks.push_back(k);
+            }
+        }
+        if (component.Closed && picks.size() < 3) {
+            picks.resize(numEdges);
+            std::iota(picks.begin(), picks.end(), 0);
+        }
+        if (!component.Closed && numEdges > 0) {
+            picks.push_back(numEdges);
+        }
+
+        Component coarseComponent{
+            static_cast<std::uint32_t>(coarse.Positions.size())};
+        std::uint32_t const base = coarseComponent.Begin;
+        for (auto const k : picks) {
+            coarse.Positions.push_back(Positions[begin + k]);
+            coarse.Normals.push_back(Normals[begin + k]);
+        }
+        int const numPicks = picks.size();
+        int const numCoarseEdges = component.Closed ? numPicks : numPicks - 1;
+        for (int p = 0; p < numCoarseEdges; p++) {
+            coarse.Indices.push_back(base + p);
+            coarse.Indices.push_back(base + (p + 1) % numPicks);
+        }
+        coarseComponent.End = coarse.Positions.size();
+        coarseComponent.Closed = component.Closed;
+        coarse.Components.push_back(coarseComponent);
+
+        if (component.Closed) {
+            picks.push_back(numEdges);
+        }
+        for (int p = 0; p < numCoarseEdges; p++) {
+            std::uint32_t const lower = picks[p];
+            std::uint32_t const upper = picks[p + 1];
+            double const range = lengths[upper] - lengths[lower];
+            for (auto k = lower; k < upper; k++) {
+                vertices[begin + k] = {
+                    base + p, base + (p + 1) % numPicks,
+                    range > 0 ? (lengths[k] - lengths[lower]) / range : 0};
+            }
+        }
+        // The last vertex of a polyline, or a lone vertex
+        if (numCoarseEdges < numPicks) {
+            std::uint32_t const last = base + numPicks - 1;
+            vertices[begin + picks.back()] = {last, last, 0};
+        }
+    }
+    coarse.ComputeAreas();
+}
+// Visits the cells holding segments at the Chebyshev distance ring from the
+// center, jumping over the runs of empty cells along each side.
+template <typename Func>
+static void ForEachInRing(Grid const &grid,
+                          std::array<std::vector<int>, 2> const &emptyRuns,
+                          Vector2i const &center, int ring, Func &&func) {
+    Vector2i const lower = (center.array() - ring).max(0).matrix();
+    Vector2i const upper =
+        (center.array() + ring).min(grid.GetSize().array() - 1).matrix();
+    auto const visitSide = [&](Vector2i cell, int axis, int end) {
+        while (cell[axis] <= end) {
+            int const run = emptyRuns[axis][grid.IndexOf(cell)];
+            if (run == 0) {
+                func(cell);
+            }
+            cell[axis] += (std::max)(run, 1);
+        }
+    };
+    // The rows at both ends, then the columns between them
+    for (int y : {center.y() - ring, center.y() + ring}) {
+        if (y >= lower.y() && y <= upper.y()) {
+            visitSide({lower.x(), y}, 0, upper.x());
+        }
+        if (ring == 0) {
+            break;
+        }
+    }
+    for (int x : {center.x() - ring, center.x() + ring}) {
+        if (ring > 0 && x >= lower.x() && x <= upper.x()) {
+            visitSide({x, (std::max)(lower.y(), center.y() - ring + 1)}, 1,
+                      (std::min)(upper.y(), center.y() + ring - 1));
+        }
+    }
+}
+
+void SurfaceMesh::BuildQueryGrid() {
+    if (Components.empty() && !Positions.empty()) {
+        spdlog::critical("Failed to build the query grid of a mesh without "
+                         "components");
+        std::exit(EXIT_FAILURE);
+    }
+    m_QueryGrid.reset();
+    std::uint32_t const numSegments = Indices.size() / 2;
+    if (numSegments == 0) {
+        return;
+    }
+
+    constexpr double inf = std::numeric_limits<double>::infinity();
+    struct Bounds {
+        Vector2d Lower = Vector2d::Constant(+inf);
+        Vector2d Upper = Vector2d::Constant(-inf);
+        double Length = 0;
+    };
+    Bounds const bounds = tbb::parallel_reduce(
+        tbb::blocked_range<std::uint32_t>(0, numSegments), Bounds(),
+        [&](tbb::blocked_range<std::uint32_t> const &range, Bounds bounds) {
+            for (auto j = range.begin(); j != range.end(); j++) {
+                Vector2d const a = Positions[Indices[2 * j]];
+                Vector2d const b = Positions[Indices[2 * j + 1]];
+                bounds.Lower = bounds.Lower.cwiseMin(a).cwiseMin(b);
+                bounds.Upper = bounds.Upper.cwiseMax(a).cwiseMax(b);
+                bounds.Length += (b - a).norm();
+            }
+            return bounds;
+        },
+        [](Bounds const &lhs, Bounds const &rhs) {
+            return Bounds{lhs.Lower.cwiseMin(rhs.Lower),
+                          lhs.Upper.cwiseMax(rhs.Upper),
+                          lhs.Length + rhs.Length};
         });
+    Vector2d const extent = bounds.Upper - bounds.Lower;
+    // Four times the mean length of the segments, so that a curve crosses a
+    // cell in about four, coarser only where the cells over the bounds would
+    // outnumber the segments by far, which keeps the grid linear in them
+    double spacing =
+        std::max(4 * bounds.Length / numSegments,
+                 std::sqrt(extent.prod() / (c_MaxQueryCellsPerSegment *
+                                            double(numSegments))));
+    if (!(spacing > 0)) {
+        spacing = 1;
+    }
+    Vector2i const size =
+        (extent / spacing).array().floor().cast<int>().matrix() +
+        Vector2i::Ones();
+    Grid const &grid = m_QueryGrid.emplace(spacing, size, bounds.Lower);
+
+    // The cells overlapped by the bounds of every segment, sorted by cell
+    auto const cellRangeOf = [&](std::uint32_t j) {
+        Vector2d const a = Positions[Indices[2 * j]];
+        Vector2d const b = Positions[Indices[2 * j + 1]];
+        return std::pair(grid.Clamp(grid.CalcLower<1>(a.cwiseMin(b))),
+                         grid.Clamp(grid.CalcLower<1>(a.cwiseMax(b))));
+    };
+    m_CellBegins.assign(grid.GetNumVertices() + 1, 0);
+    tbb::parallel_for(std::uint32_t(0), numSegments, [&](std::uint32_t j) {
+        auto const [lower, upper] = cellRangeOf(j);
+        for (int x = lower.x(); x <= upper.x(); x++) {
+            for (int y = lower.y(); y <= upper.y(); y++) {
+                std::atomic_ref(m_CellBegins[grid.IndexOf({x, y}) + 1])
+                    .fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    });
+    std::partial_sum(m_CellBegins.begin(), m_CellBegins.end(),
+                     m_CellBegins.begin());
+    std::vector<std::uint32_t> cursors(m_CellBegins.begin(),
+                                       m_CellBegins.end() - 1);
+    m_CellSegments.resize(m_CellBegins.back());
+    tbb::parallel_for(std::uint32_t(0), numSegments, [&](std::uint32_t j) {
+        auto const [lower, upper] = cellRangeOf(j);
+        for (int x = lower.x(); x <= upper.x(); x++) {
+            for (int y = lower.y(); y <= upper.y(); y++) {
+                auto const slot =
+                    std::atomic_ref(cursors[grid.IndexOf({x, y})])
+                        .fetch_add(1, std::memory_order_relaxed);
+                m_CellSegments[slot] = j;
+            }
+        }
+    });
+    tbb::parallel_for(0, grid.GetNumVertices(), [&](int cell) {
+        std::sort(m_CellSegments.begin() + m_CellBegins[cell],
+                  m_CellSegments.begin() + m_CellBegins[cell + 1]);
+    });
+
+    // The number of empty cells from every cell on along each axis, with
+    // which the queries jump over the empty parts of their rings
+    for (int axis = 0; axis < 2; axis++) {
+        auto &runs = m_EmptyRuns[axis];
+        runs.resize(grid.GetNumVertices());
+        int const numLines = size[1 - axis];
+        tbb::parallel_for(0, numLines, [&](int line) {
+            int run = 0;
+            for (int i = size[axis] - 1; i >= 0; i--) {
+                Vector2i coord;
+                coord[axis] = i;
+                coord[1 - axis] = line;
+                int const cell = grid.IndexOf(coord);
+                run = m_CellBegins[cell] < m_CellBegins[cell + 1] ? 0 : run + 1;
+                runs[cell] = run;
+            }
+        });
+    }
+}
+
+SurfaceMesh::ClosestPoint SurfaceMesh::FindClosest(Vector2d const &pos) const {
+    if (Indices.empty()) {
+        return {std::numeric_limits<double>::infinity(), 0, 0};
+    }
+    ClosestPoint closest{std::numeric_limits<double>::infinity(), 0, 0};
+    auto const consider = [&](std::uint32_t j) {
+        Vector2d const a = Positions[Indices[2 * j]];
+        Vector2d const ab = Positions[Indices[2 * j + 1]] - a;
+        double const squaredLength = ab.squaredNorm();
+        double const fraction =
+            squaredLength > 0
+                ? std::clamp((pos - a).dot(ab) / squaredLength, 0., 1.)
+                : 0.;
+        double const squaredDistance = (a + fraction * ab - pos).squaredNorm();
+        // The first segment of ties, whatever the order of the cells
+        if (squaredDistance < closest.SquaredDistance ||
+            (squaredDistance == closest.SquaredDistance &&
+             j < closest.Segment)) {
+            closest = {squaredDistance, j, fraction};
+        }
+    };
+    if (!m_QueryGrid) {
+        // Over every segment, for a mesh not built by a contour
+        for (std::uint32_t j = 0; j < Indices.size() / 2; j++) {
+            consider(j);
+        }
+        return closest;
+    }
+    Grid const &grid = *m_QueryGrid;
+    Vector2i const center = grid.Clamp(grid.CalcLower<1>(pos));
+    int const numRings =
+        center.cwiseMax(grid.GetSize() - center - Vector2i::Ones()).maxCoeff() +
+        1;
+    for (int ring = 0; ring < numRings; ring++) {
+        ForEachInRing(
+            grid, m_EmptyRuns, center, ring, [&](Vector2i const &cell) {
+                int const index = grid.IndexOf(cell);
+                for (auto k = m_CellBegins[index];
+                     k < m_CellBegins[index + 1]; k++) {
+                    consider(m_CellSegments[k]);
+                }
+            });
+        // The cells of the next rings are at least this far
+        double const bound = ring * grid.GetSpacing();
+        if (closest.SquaredDistance <= bound * bound) {
+            break;
+        }
+    }
+    return closest;
+}
+
+Vector2d SurfaceMesh::PositionOf(ClosestPoint const &closest) const {
+    Vector2d const a = Positions[Indices[2 * closest.Segment]];
+    Vector2d const b = Positions[Indices[2 * closest.Segment + 1]];
+    return a + closest.Fraction * (b - a);
+}
+
+Vector2d SurfaceMesh::FeatureNormalOf(ClosestPoint const &closest) const {
+    auto const normalOf = [&](std::uint32_t i0, std::uint32_t i1) {
+        Vector2d const edge = Positions[i1] - Positions[i0];
+        return Vector2d(edge.y(), -edge.x()).normalized().eval();
+    };
+    std::uint32_t const i0 = Indices[2 * closest.Segment];
+    std::uint32_t const i1 = Indices[2 * closest.Segment + 1];
+    Vector2d normal = normalOf(i0, i1);
+    // Of the segment alone without the components, which may give the wrong
+    // side at a sharp corner
+    if ((closest.Fraction > 0 && closest.Fraction < 1) || Components.empty()) {
+        return normal;
+    }
+    // The other segment at the vertex, if any
+    std::uint32_t const vertex = closest.Fraction > 0 ? i1 : i0;
+    auto const component =
+        std::prev(std::upper_bound(Components.begin(), Components.end(),
+                                   vertex, [](std::uint32_t i, auto const &c) {
+                                       return i < c.Begin;
+                                   }));
+    if (vertex == i0 && (component->Closed || vertex > component->Begin)) {
+        normal += normalOf(PrevOf(*component, vertex), vertex);
+    } else if (vertex == i1 &&
+               (component->Closed || vertex + 1 < component->End)) {
+        normal += normalOf(vertex, NextOf(*component, vertex));
+    }
+    return normal;
+}
+
+Vector2d SurfaceMesh::ClosestPositionOf(Vector2d const &pos) const {
+    return PositionOf(FindClosest(pos));
+}
+
+Vector2d SurfaceMesh::ClosestNormalOf(Vector2d const &pos) const {
+    ClosestPoint const closest = FindClosest(pos);
+    if (Indices.empty()) {
+        return Vector2d::Zero();
+    }
+    Vector2d const normal = FeatureNormalOf(closest);
+    Vector2d const offset = pos - PositionOf(closest);
+    double const distance = offset.norm();
+    if (distance == 0) {
+        return normal.normalized();
+    }
+    return offset.dot(normal) < 0 ? (-offset / distance).eval()
+                                  : (offset / distance).eval();
+}
+
+double SurfaceMesh::SignedDistanceTo(Vector2d const &pos) const {
+    ClosestPoint const closest = FindClosest(pos);
+    if (Indices.empty()) {
+        return closest.SquaredDistance;
+    }
+    double const distance = std::sqrt(closest.SquaredDistance);
+    return (pos - PositionOf(closest)).dot(FeatureNormalOf(closest)) < 0
+               ? -distance
+               : distance;
+}
+
+void SurfaceMesh::SignedDistancesTo(std::span<Vector2d const> positions,
+                                    std::span<double> distances) const {
+    tbb::parallel_for(std::size_t(0), positions.size(), [&](std::size_t i) {
+        distances[i] = SignedDistanceTo(positions[i]);
+    });
+}
+
+void SurfaceMesh::ClosestNormalsOf(std::span<Vector2d const> positions,
+                                   std::span<Vector2d> normals) const {
+    tbb::parallel_for(std::size_t(0), positions.size(), [&](std::size_t i) {
+        normals[i] = ClosestNormalOf(positions[i]);
+    });
 }
 } // namespace Pivot
@@ -1,36 +1,109 @@
 #pragma once
 
+#include "Grid.h"
 #include "Surface.h"
 
 namespace Pivot {
 class SurfaceMesh : public Surface {
+  public:
+    // A vertex between two vertices of a resampled mesh, at the fraction
+    // Weight of the arc length from Lower to Upper
+    struct ResampledVertex {
+        std::uint32_t Lower;
+        std::uint32_t Upper;
+        double Weight;
+    };
+    // A point of the mesh closest to a position
+    struct ClosestPoint {
+        double SquaredDistance;
+        std::uint32_t Segment; // the pair of Indices starting at 2 * Segment
+        double Fraction;       // from the first vertex of the segment
+    };
+    // A polyline, whose vertices are contiguous in the mesh in its order
+    struct Component {
+        std::uint32_t Begin;
+        std::uint32_t End = 0;
+        bool Closed = false;
+        double Volume = 0; // set by ComputeVolume
+    };
+
   public:
     SurfaceMesh() = default;
 
-    virtual Vector2d ClosestNormalOf(Vector2d const &pos) const override {
-        return Vector2d::Zero();
-    } // FIXME
-    virtual double SignedDistanceTo(Vector2d const &pos) const override {
-        return 0;
-    } // FIXME
+    // Positive on the right of the segments, outside the counterclockwise
+    // loops around the liquid. The queries search the grid built by
+    // BuildQueryGrid, which Contour::Generate builds, or every segment
+    // without it. Without the components, the side at a vertex is that of
+    // one of its segments, which may be wrong at a sharp corner.
+    virtual Vector2d ClosestPositionOf(Vector2d const &pos) const override;
+    virtual Vector2d ClosestNormalOf(Vector2d const &pos) const override;
+    virtual double SignedDistanceTo(Vector2d const &pos) const override;
+
+    // Queries of many positions in parallel
+    void SignedDistancesTo(std::span<Vector2d const> positions,
+                           std::span<double> distances) const;
+    void ClosestNormalsOf(std::span<Vector2d const> positions,
+                          std::span<Vector2d> normals) const;
 
     void Clear();
     void Export(std::ostream &out) const;
 
+    // Links the segments into polylines and reorders the vertices along them,
+    // one polyline after another with the open ones first. The segments
+    // follow in the same order. Gives the new index of every vertex.
+    void BuildComponents(std::vector<std::uint32_t> &newIndices);
+
     void ComputeAreas();
+    // Along the components, which are required
     void ComputeVolume();
     void ComputeMeanCurvatures();
 
+    // Builds a coarser mesh from a subset of the vertices, spaced evenly along
+    // every component by the arc length over spacing plus the turning angle
+    // over maxAngle, so that curved parts keep more vertices. Every vertex is
+    // located between two vertices of the coarse mesh.
+    void Resample(double spacing, double maxAngle, SurfaceMesh &coarse,
+                  std::vector<ResampledVertex> &vertices) const;
+
+    // Bins the segments into a uniform grid over the bounds of the mesh, with
+    // cells of about four segments, which the distance queries search in rings
+    // around the queried position. The cells are at most 16 times as many
+    // as the segments, larger for a long curve over wide bounds.
+    void BuildQueryGrid();
+    ClosestPoint FindClosest(Vector2d const &pos) const;
+    Vector2d PositionOf(ClosestPoint const &closest) const;
+    // Of the segment, or the sum of the normals of the segments at a vertex,
+    // which gives the side of the positions closest to the vertex
+    Vector2d FeatureNormalOf(ClosestPoint const &closest) const;
+
     int size() { return Positions.size(); }
 
+    // The neighbors of a vertex along its component, the first and the last
+    // of a closed one being adjacent
+    static std::uint32_t NextOf(Component const &component, std::uint32_t i) {
+        return i + 1 < component.End ? i + 1 : component.Begin;
+    }
+    static std::uint32_t PrevOf(Component const &component, std::uint32_t i) {
+        return i > component.Begin ? i - 1 : component.End - 1;
+    }
+
   public:
     std::vector<Vector2d> Positions;
     std::vector<Vector2d> Normals;
     std::vector<std::uint32_t> Indices;
+    std::vector<Component> Components;
 
     std::vector<double> Areas;
     double TotalArea;
     double TotalVolume;
     std::vector<double> MeanCurvatures;
+
+  private:
+    static constexpr int c_MaxQueryCellsPerSegment = 16;
+
+    std::optional<Grid> m_QueryGrid;
+    std::vector<std::uint32_t> m_CellBegins; // into the segments of the cells
+    std::vector<std::uint32_t> m_CellSegments;
+    std::array<std::vector<int>, 2> m_EmptyRuns; // from every cell per axis
 };
 } // namespace Pivot
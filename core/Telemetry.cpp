@@ -0,0 +1,51 @@
+#include "Telemetry.h"
+
+namespace Pivot {
+	static constexpr std::array c_MetricNames = {
+		"frame", "substep", "time", "dt", "cfl", "rejected", "dt_error",
+		"fluid_cells", "contour_vertices", "contour_components",
+		"pressure_iters", "pressure_residual", "magnetic_iters", "magnetic_residual_l1", "magnetic_residual_max", "magnetic_std_error",
+		"magnetic_vertices", "magnetic_resample_error",
+		"volume", "volume_error",
+		"t_advect", "t_surface_pressure", "t_project",
+	};
+
+	static auto MetricValuesOf(SubstepMetrics const &m) {
+		return std::array<std::string, c_MetricNames.size()> {
+			fmt::format("{}", m.Frame), fmt::format("{}", m.Substep), fmt::format("{:.9g}", m.Time), fmt::format("{:.9g}", m.DeltaTime), fmt::format("{:.6g}", m.CourantNumber), fmt::format("{}", m.NumRejected), fmt::format("{:.6e}", m.TimeStepError),
+			fmt::format("{}", m.NumFluidCells), fmt::format("{}", m.NumContourVertices), fmt::format("{}", m.NumContourComponents),
+			fmt::format("{}", m.PressureIterations), fmt::format("{:.6e}", m.PressureResidual), fmt::format("{}", m.MagneticIterations), fmt::format("{:.6e}", m.MagneticResidualL1), fmt::format("{:.6e}", m.MagneticResidualMax), fmt::format("{:.6e}", m.MagneticStdError),
+			fmt::format("{}", m.MagneticVertices), fmt::format("{:.6e}", m.MagneticResampleError),
+			fmt::format("{:.9e}", m.Volume), fmt::format("{:.6e}", m.VolumeError),
+			fmt::format("{:.6f}", m.AdvectTime), fmt::format("{:.6f}", m.SurfacePressureTime), fmt::format("{:.6f}", m.ProjectTime),
+		};
+	}
+
+	MetricsWriter::MetricsWriter(std::filesystem::path const &filename) :
+		m_Out(filename, std::ios::trunc),
+		m_Csv { filename.extension() == ".csv" } {
+		if (!m_Out) {
+			spdlog::critical("Failed to open metrics file \"{}\"", filename.string());
+			std::exit(EXIT_FAILURE);
+		}
+		if (m_Csv) {
+			m_Out << fmt::format("{}\n", fmt::join(c_MetricNames, ","));
+		}
+	}
+
+	void MetricsWriter::Write(SubstepMetrics const &metrics) {
+		auto const values = MetricValuesOf(metrics);
+		if (m_Csv) {
+			m_Out << fmt::format("{}\n", fmt::join(values, ","));
+		} else {
+			m_Out << '{';
+			for (std::size_t i = 0; i < values.size(); i++) {
+				// Non-finite numbers are not valid JSON
+				bool const finite = values[i].find_first_of("ni") == std::string::npos;
+				m_Out << fmt::format("{}\"{}\":{}", i ? "," : "", c_MetricNames[i], finite ? values[i] : "null");
+			}
+			m_Out << "}\n";
+		}
+		m_Out.flush();
+	}
+}
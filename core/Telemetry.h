@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Common.h"
+
+namespace Pivot {
+	// Sizes, solver convergence and timings of one substep.
+	struct SubstepMetrics {
+		std::uint32_t Frame = 0;
+		std::uint32_t Substep = 0;
+		double        Time = 0;
+		double        DeltaTime = 0;
+		double        CourantNumber = 0;
+		int           NumRejected = 0;   // attempts rejected before this substep
+		double        TimeStepError = 0; // estimate of the time step controller, in cells
+
+		int           NumFluidCells = 0;
+		int           NumContourVertices = 0;
+		int           NumContourComponents = 0; // closed loops and open polylines
+
+		int           PressureIterations = 0;
+		double        PressureResidual = 0;
+		int           MagneticIterations = 0;  // zero for the Monte Carlo estimator
+		double        MagneticResidualL1 = 0;  // mean absolute update of the last iteration
+		double        MagneticResidualMax = 0; // max absolute update of the last iteration
+		double        MagneticStdError = 0;    // max standard error of the Monte Carlo normal field
+		int           MagneticVertices = 0;      // of the boundary solved on, fewer than the contour when resampled
+		double        MagneticResampleError = 0; // relative pressure error of the resampled solve, when checked
+
+		double        Volume = 0;
+		double        VolumeError = 0; // relative to the initial volume
+
+		double        AdvectTime = 0; // seconds, including body forces
+		double        SurfacePressureTime = 0;
+		double        ProjectTime = 0;
+	};
+
+	// Streams SubstepMetrics as CSV if the file name ends with ".csv", and as JSON lines otherwise.
+	class MetricsWriter {
+	public:
+		explicit MetricsWriter(std::filesystem::path const &filename);
+
+		void Write(SubstepMetrics const &metrics);
+
+	private:
+		std::ofstream m_Out;
+		bool          m_Csv;
+	};
+}
@@ -0,0 +1,40 @@
+#include "TimeStepController.h"
+
+namespace Pivot {
+	static constexpr double c_MinScale = 1e-3;
+
+	TimeStepController::TimeStepController(TimeStepOptions const &options) :
+		m_Options { options } {
+	}
+
+	double TimeStepController::Propose(Simulation const &simulation) {
+		auto const limits = std::to_array({
+			simulation.GetCourantTimeStep() * m_Options.CourantNumber,
+			simulation.GetCapillaryTimeStep() * m_Options.CapillaryFactor,
+			simulation.GetMagneticTimeStep() * m_Options.MagneticFactor,
+		});
+		auto const iter = std::min_element(limits.begin(), limits.end());
+		m_Limit = static_cast<Limit>(iter - limits.begin());
+		return *iter * m_Scale;
+	}
+
+	bool TimeStepController::Accept(double deltaTime, double courantTimeStepBefore, double courantTimeStepAfter) {
+		m_Error = deltaTime * std::abs(1. / courantTimeStepAfter - 1. / courantTimeStepBefore);
+		if (!IsRejectionEnabled()) return true;
+		double const factor = m_Error > 0 ? .9 * std::sqrt(m_Options.ErrorTolerance / m_Error) : 2.;
+		if (m_Error > m_Options.ErrorTolerance && m_Scale > c_MinScale) {
+			m_Scale = std::max(m_Scale * std::clamp(factor, .2, .9), c_MinScale);
+			return false;
+		}
+		m_Scale = std::min(1., m_Scale * std::min(factor, 2.));
+		return true;
+	}
+
+	char const *TimeStepController::NameOf(Limit limit) {
+		switch (limit) {
+		case Limit::Capillary: return "capillary";
+		case Limit::Magnetic:  return "magnetic";
+		default:               return "courant";
+		}
+	}
+}
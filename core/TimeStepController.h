@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Simulation.h"
+
+namespace Pivot {
+	struct TimeStepOptions {
+		double CourantNumber   = 1; // fraction of the advective limit
+		double CapillaryFactor = 1; // fraction of the capillary limit
+		double MagneticFactor  = 1; // fraction of the magnetic pressure limit
+		double ErrorTolerance  = 0; // in cells, zero to never reject a step
+	};
+
+	// Proposes the largest stable time step under the advective, capillary and magnetic pressure limits. With an
+	// error tolerance, a step whose error estimate exceeds it is rejected, and the following proposals shrink and
+	// then grow back towards the stable limit.
+	class TimeStepController {
+	public:
+		enum class Limit { Courant, Capillary, Magnetic };
+
+		explicit TimeStepController(TimeStepOptions const &options);
+
+		bool  IsRejectionEnabled() const { return m_Options.ErrorTolerance > 0; }
+		Limit GetLimit          () const { return m_Limit; }
+		double GetError         () const { return m_Error; }
+
+		double Propose(Simulation const &simulation);
+		// Takes the Courant time steps before and after the step. The error estimate is the change in how many
+		// cells the fastest sample travels within the step, which grows when the explicit surface forces go unstable.
+		bool Accept(double deltaTime, double courantTimeStepBefore, double courantTimeStepAfter);
+
+		static char const *NameOf(Limit limit);
+
+	private:
+		TimeStepOptions m_Options;
+		double          m_Scale = 1; // of the stable limit, below one after rejections
+		Limit           m_Limit = Limit::Courant;
+		double          m_Error = 0;
+	};
+}
@@ -0,0 +1,149 @@
+#include "Tracer.h"
+
+#include <map>
+#include <mutex>
+#include <numeric>
+
+namespace Pivot {
+	using Clock = std::chrono::steady_clock;
+
+	struct TraceEvent {
+		std::uint32_t Path;
+		std::int64_t  BeginTime; // nanoseconds since the tracer started
+		std::int64_t  Duration;
+	};
+
+	struct TracePath {
+		char const   *Name;
+		std::uint32_t Parent; // c_NoPath for roots
+		std::uint32_t Depth;
+	};
+
+	struct TraceBuffer {
+		using PathKey = std::pair<std::uint32_t, char const *>;
+
+		std::uint32_t                     ThreadId;
+		std::vector<std::uint32_t>        Stack;
+		std::map<PathKey, std::uint32_t>  PathCache;
+		std::mutex                        Mutex; // guards Events against readers
+		std::vector<TraceEvent>           Events;
+		std::size_t                       SummaryBegin = 0;
+	};
+
+	static constexpr std::uint32_t c_NoPath = ~std::uint32_t(0);
+
+	static Clock::time_point const                   s_Origin = Clock::now();
+	static std::mutex                                s_Mutex; // guards the registries below
+	static std::vector<TracePath>                    s_Paths;
+	static std::vector<std::shared_ptr<TraceBuffer>> s_Buffers;
+
+	static TraceBuffer &GetThreadBuffer() {
+		thread_local std::shared_ptr<TraceBuffer> buffer = [] {
+			auto buf = std::make_shared<TraceBuffer>();
+			std::lock_guard lock(s_Mutex);
+			buf->ThreadId = static_cast<std::uint32_t>(s_Buffers.size());
+			s_Buffers.push_back(buf);
+			return buf;
+		}();
+		return *buffer;
+	}
+
+	static std::uint32_t GetPath(TraceBuffer &buffer, char const *name) {
+		std::uint32_t const parent = buffer.Stack.empty() ? c_NoPath : buffer.Stack.back();
+		auto const key = std::pair(parent, name);
+		if (auto it = buffer.PathCache.find(key); it != buffer.PathCache.end()) {
+			return it->second;
+		}
+		std::lock_guard lock(s_Mutex);
+		std::uint32_t path = 0;
+		while (path < s_Paths.size() && !(s_Paths[path].Parent == parent && std::strcmp(s_Paths[path].Name, name) == 0)) {
+			path++;
+		}
+		if (path == s_Paths.size()) {
+			s_Paths.push_back({ name, parent, parent == c_NoPath ? 0 : s_Paths[parent].Depth + 1 });
+		}
+		buffer.PathCache[key] = path;
+		return path;
+	}
+
+	static std::int64_t Now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - s_Origin).count();
+	}
+
+	void Tracer::Scope::Begin(char const *name) {
+		auto &buffer = GetThreadBuffer();
+		m_Path = GetPath(buffer, name);
+		buffer.Stack.push_back(m_Path);
+		m_Active = true;
+		m_BeginTime = Now();
+	}
+
+	void Tracer::Scope::End() {
+		auto const endTime = Now();
+		auto &buffer = GetThreadBuffer();
+		buffer.Stack.pop_back();
+		std::lock_guard lock(buffer.Mutex);
+		buffer.Events.push_back({ m_Path, m_BeginTime, endTime - m_BeginTime });
+	}
+
+	void Tracer::PrintSummary(std::string_view title) {
+		std::vector<std::vector<double>> durations;
+		std::vector<TracePath> paths;
+		{
+			std::lock_guard lock(s_Mutex);
+			paths = s_Paths;
+			durations.resize(paths.size());
+			for (auto const &buffer : s_Buffers) {
+				std::lock_guard bufferLock(buffer->Mutex);
+				for (std::size_t i = buffer->SummaryBegin; i < buffer->Events.size(); i++) {
+					durations[buffer->Events[i].Path].push_back(buffer->Events[i].Duration * 1e-6);
+				}
+				buffer->SummaryBegin = buffer->Events.size();
+			}
+		}
+		// Order phases depth-first, keeping siblings in the order they were first seen
+		auto const chainOf = [&](std::uint32_t path) {
+			std::vector<std::uint32_t> chain;
+			for (; path != c_NoPath; path = paths[path].Parent) chain.push_back(path);
+			std::reverse(chain.begin(), chain.end());
+			return chain;
+		};
+		std::vector<std::uint32_t> order(paths.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::sort(order.begin(), order.end(), [&](auto lhs, auto rhs) { return chainOf(lhs) < chainOf(rhs); });
+
+		fmt::print(fmt::fg(fmt::color::yellow_green), "[Trace] {}\n", title);
+		fmt::print("{:<32} {:>8} {:>11} {:>10} {:>10} {:>10} {:>10}\n", "phase", "count", "total(ms)", "mean", "min", "max", "p95");
+		for (auto const path : order) {
+			auto &durs = durations[path];
+			if (durs.empty()) continue;
+			std::sort(durs.begin(), durs.end());
+			double const total = std::accumulate(durs.begin(), durs.end(), 0.);
+			double const p95 = durs[std::min(durs.size() - 1, static_cast<std::size_t>(std::ceil(durs.size() * .95)) - 1)];
+			auto const label = std::string(paths[path].Depth * 2, ' ') + paths[path].Name;
+			fmt::print("{:<32} {:>8} {:>11.3f} {:>10.3f} {:>10.3f} {:>10.3f} {:>10.3f}\n", label, durs.size(), total, total / durs.size(), durs.front(), durs.back(), p95);
+		}
+	}
+
+	void Tracer::WriteChromeTrace(std::filesystem::path const &filename) {
+		std::ofstream out(filename);
+		if (!out) {
+			spdlog::error("Failed to write trace \"{}\"", filename.string());
+			return;
+		}
+		std::lock_guard lock(s_Mutex);
+		out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+		bool first = true;
+		for (auto const &buffer : s_Buffers) {
+			std::lock_guard bufferLock(buffer->Mutex);
+			for (auto const &event : buffer->Events) {
+				auto const &path = s_Paths[event.Path];
+				out << (first ? "\n" : ",\n") << fmt::format(
+					R"({{"name":"{}","ph":"X","pid":0,"tid":{},"ts":{:.3f},"dur":{:.3f},"args":{{"depth":{}}}}})",
+					path.Name, buffer->ThreadId, event.BeginTime * 1e-3, event.Duration * 1e-3, path.Depth);
+				first = false;
+			}
+		}
+		out << "\n]}\n";
+	}
+}
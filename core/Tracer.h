@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Common.h"
+
+namespace Pivot {
+	// Records nested, named scopes into per-thread buffers. Scopes opened inside another scope on the same thread
+	// become its children, so phases are summarized as a tree. While disabled, a scope costs one relaxed load.
+	class Tracer {
+	public:
+		class Scope {
+		public:
+			explicit Scope(char const *name) { if (IsEnabled()) Begin(name); } // name must be a string literal
+			~Scope() { if (m_Active) End(); }
+
+			Scope(Scope const &) = delete;
+			Scope &operator=(Scope const &) = delete;
+
+		private:
+			void Begin(char const *name);
+			void End();
+
+		private:
+			bool          m_Active = false;
+			std::uint32_t m_Path;
+			std::int64_t  m_BeginTime;
+		};
+
+	public:
+		static void SetEnabled(bool enabled) { s_Enabled.store(enabled, std::memory_order_relaxed); }
+		static bool IsEnabled() { return s_Enabled.load(std::memory_order_relaxed); }
+
+		// Prints count, total, mean, min, max and p95 of every phase recorded since the previous summary.
+		static void PrintSummary(std::string_view title);
+		// Writes all recorded scopes in the Chrome trace-event format (chrome://tracing, Perfetto).
+		static void WriteChromeTrace(std::filesystem::path const &filename);
+
+	private:
+		static inline std::atomic<bool> s_Enabled = false;
+	};
+}
@@ -0,0 +1,71 @@
+#include "Batch.h"
+
+namespace Pivot {
+	Batch::Batch(std::filesystem::path const &filename, std::filesystem::path const &dirname) {
+		try {
+			YAML::Node const root = YAML::LoadFile(filename.string());
+			YAML::Node const defaults = root["defaults"];
+			for (auto const &run : root["runs"]) {
+				BatchRun batchRun;
+				batchRun.Name = run["name"].as<std::string>();
+				ParseSimBuildOptions(defaults, batchRun.Sim);
+				ParseSimBuildOptions(run, batchRun.Sim);
+				// The output section of a scene file comes first, then the list
+				if (!batchRun.Sim.Config.empty()) {
+					ParseDriverOptions(LoadSceneOutput(batchRun.Sim.Config), batchRun.Driver);
+				}
+				ParseDriverOptions(defaults, batchRun.Driver);
+				ParseDriverOptions(run, batchRun.Driver);
+				batchRun.Driver.Dirname = dirname / batchRun.Name;
+				batchRun.Driver.TraceName.clear(); // the tracer is shared by all runs
+				batchRun.Driver.Verbose = false;
+				if (batchRun.Driver.EndFrame == 0) {
+					spdlog::critical("Failed to find the end frame of run \"{}\"", batchRun.Name);
+					std::exit(EXIT_FAILURE);
+				}
+				if (batchRun.Driver.FrameRate <= 0) {
+					spdlog::critical("Failed to find the frame rate of run \"{}\"", batchRun.Name);
+					std::exit(EXIT_FAILURE);
+				}
+				m_Runs.push_back(std::move(batchRun));
+			}
+		} catch (YAML::Exception const &e) {
+			spdlog::critical("Failed to load run list \"{}\": {}", filename.string(), e.what());
+			std::exit(EXIT_FAILURE);
+		}
+		if (m_Runs.empty()) {
+			spdlog::critical("Failed to find any run in \"{}\"", filename.string());
+			std::exit(EXIT_FAILURE);
+		}
+	}
+
+	void Batch::Run() const {
+		using Clock = std::chrono::steady_clock;
+		std::vector<DriverStats> stats(m_Runs.size());
+		spdlog::info("Begin {} runs on {} threads", m_Runs.size(), tbb::this_task_arena::max_concurrency());
+		auto const beginTime = Clock::now();
+		tbb::task_group group;
+		for (std::size_t i = 0; i < m_Runs.size(); i++) {
+			group.run([&, i] {
+				// Waiting for its own loops, a run must not pick up another run and stall until that one completes
+				tbb::this_task_arena::isolate([&] {
+					auto simulation = SimBuilder::Build(m_Runs[i].Sim);
+					stats[i] = Driver(m_Runs[i].Driver).Run(simulation.get());
+				});
+				spdlog::info("Finish run \"{}\": {} substeps ({} rejected) in {:.3f}s, {:.1f} substeps/s",
+					m_Runs[i].Name, stats[i].NumSubsteps, stats[i].NumRejected, stats[i].Seconds, stats[i].NumSubsteps / stats[i].Seconds);
+			});
+		}
+		group.wait();
+		double const seconds = std::chrono::duration<double>(Clock::now() - beginTime).count();
+
+		std::uint64_t numSubsteps = 0;
+		fmt::print(fmt::fg(fmt::color::yellow_green), "[Batch]\n");
+		fmt::print("{:<24} {:>10} {:>10} {:>10} {:>12}\n", "run", "substeps", "rejected", "time(s)", "substeps/s");
+		for (std::size_t i = 0; i < m_Runs.size(); i++) {
+			fmt::print("{:<24} {:>10} {:>10} {:>10.3f} {:>12.1f}\n", m_Runs[i].Name, stats[i].NumSubsteps, stats[i].NumRejected, stats[i].Seconds, stats[i].NumSubsteps / stats[i].Seconds);
+			numSubsteps += stats[i].NumSubsteps;
+		}
+		fmt::print("{:<24} {:>10} {:>10} {:>10.3f} {:>12.1f}\n", "total", numSubsteps, "", seconds, numSubsteps / seconds);
+	}
+}
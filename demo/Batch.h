@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Driver.h"
+#include "SimBuilder.h"
+
+namespace Pivot {
+	struct BatchRun {
+		std::string         Name; // also the output subdirectory
+		SimBuildOptions     Sim;
+		DriverCreateOptions Driver;
+	};
+
+	// Runs the simulations of a run list at the same time in the shared task arena, so that small grids fill the
+	// cores that one of them alone would leave idle. The list is a YAML file of the form
+	//   defaults: { test: box, scale: 128, rate: 50, end: 11 }
+	//   runs:
+	//     - { name: weak, chi: .2, hext: [0, 3e4] }
+	//     - { name: strong, chi: 1, surface-tension: .05 }
+	// where every run overrides the defaults with the keys of the command line options. A run with a config key
+	// builds that scene file and takes its output section before the keys of the list.
+	class Batch {
+	public:
+		Batch(std::filesystem::path const &filename, std::filesystem::path const &dirname);
+
+		void Run() const;
+
+	private:
+		std::vector<BatchRun> m_Runs;
+	};
+}
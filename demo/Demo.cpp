@@ -1,21 +1,8 @@
-#include "Driver.h"
-#include "SimBuilder.h"
+#include "Batch.h"
+#include "Scheduler.h"
 
 #include <cxxopts.hpp>
 
-Pivot::Simulation::Scene ParseSceneName(std::string_view name) {
-	using namespace Pivot;
-	static std::unordered_map<std::string, Simulation::Scene> const s_SceneFromName = {
-		{ "box", Simulation::Scene::Box },
-	};
-	if (auto iter = s_SceneFromName.find(name.data()); iter != s_SceneFromName.end()) {
-		return iter->second;
-	} else {
-		spdlog::critical("Failed to parse test case name");
-		std::exit(EXIT_FAILURE);
-	}
-}
-
 auto ParseArgs(int argc, char **argv) {
 	try {
 		cxxopts::Options argParser("demo", "The demo of Particle-In-Cell liquid simulation");
@@ -24,30 +11,80 @@ auto ParseArgs(int argc, char **argv) {
 			("b,begin"  , "Begin frame"   , cxxopts::value<std::uint32_t>()->default_value("0"))
 			("e,end"    , "End frame"     , cxxopts::value<std::uint32_t>())
 			("t,test"   , "Test case"     , cxxopts::value<std::string>())
+			("config"   , "Scene file in place of the test case", cxxopts::value<std::string>()->default_value(""))
 			("s,scale"  , "Size scale"    , cxxopts::value<int>()->default_value("-1"))
 			("r,rate"   , "Frame rate"    , cxxopts::value<double>())
 			("c,cfl"    , "Courant number", cxxopts::value<double>()->default_value("1"))
+			("capillary", "Fraction of the capillary time step limit", cxxopts::value<double>()->default_value("1"))
+			("magnetic-dt", "Fraction of the magnetic time step limit", cxxopts::value<double>()->default_value("1"))
+			("tolerance", "Error tolerance in cells for rejecting substeps (0 to disable)", cxxopts::value<double>()->default_value("0"))
+			("a,archive", "Frame archive" , cxxopts::value<std::string>()->default_value(""))
+			("f,fields" , "Archived fields (none, raw, quantized)", cxxopts::value<std::string>()->default_value("none"))
+			("snapshot" , "Save restart snapshots")
+			("trace"    , "Chrome trace file of per-phase timings", cxxopts::value<std::string>()->default_value(""))
+			("metrics"  , "Per-substep metrics file (.csv or .jsonl)", cxxopts::value<std::string>()->default_value(""))
+			("j,threads", "Worker threads (0 for all cores)", cxxopts::value<int>()->default_value("0"))
+			("pin"      , "Pin worker threads to cores")
+			("first-core", "First core to pin to", cxxopts::value<int>()->default_value("0"))
+			("numa"     , "NUMA node to run on (-1 for any)", cxxopts::value<int>()->default_value("-1"))
+			("grains"   , "Grain cache file of the parallel kernels", cxxopts::value<std::string>()->default_value(""))
+			("tune"     , "Tune the missing grain cache entries")
+			("batch"    , "Run list to simulate at the same time, with outputs in subdirectories", cxxopts::value<std::string>()->default_value(""))
 			("h,help"   , "Print usage");
 		auto result = argParser.parse(argc, argv);
 		if (result.count("help")) {
 			std::cout << argParser.help() << std::endl;
 			std::exit(EXIT_SUCCESS);
 		}
-		Pivot::DriverCreateOptions driverOpt = {
-			.Dirname       = result["dirname"].as<std::string>(),
-			.BeginFrame    = result["begin"].as<std::uint32_t>(),
-			.EndFrame      = result["end"].as<std::uint32_t>(),
-			.FrameRate     = result["rate"].as<double>(),
-			.CourantNumber = result["cfl"].as<double>(),
-		};
-		Pivot::SimBuildOptions simOpt = {
-			.Scene = ParseSceneName(result["test"].as<std::string>()),
-			.Scale = result["scale"].as<int>(),
+		auto const batchName = result["batch"].as<std::string>();
+		// The options given on the command line take precedence over the output section of a scene file
+		YAML::Node given;
+		for (auto const &arg : result.arguments()) {
+			given[arg.key()] = arg.value();
+		}
+		Pivot::DriverCreateOptions driverOpt = { .Dirname = result["dirname"].as<std::string>() };
+		Pivot::SimBuildOptions     simOpt;
+		if (batchName.empty()) { // the command line describes the only run
+			Pivot::ParseSimBuildOptions(given, simOpt);
+			if (!simOpt.Config.empty()) {
+				Pivot::ParseDriverOptions(Pivot::LoadSceneOutput(simOpt.Config), driverOpt);
+			} else if (!result.count("test")) {
+				spdlog::critical("Failed to find the test case or scene file to simulate");
+				std::exit(EXIT_FAILURE);
+			}
+			Pivot::ParseDriverOptions(given, driverOpt);
+			if (driverOpt.EndFrame == 0) {
+				spdlog::critical("Failed to find the end frame");
+				std::exit(EXIT_FAILURE);
+			}
+			if (driverOpt.FrameRate <= 0) {
+				spdlog::critical("Failed to find the frame rate");
+				std::exit(EXIT_FAILURE);
+			}
+		}
+		Pivot::SchedulerOptions schedOpt = {
+			.NumThreads = result["threads"].as<int>(),
+			.Pinned     = result.count("pin") > 0,
+			.FirstCore  = result["first-core"].as<int>(),
+			.NumaNode   = result["numa"].as<int>(),
 		};
-		return std::pair(driverOpt, simOpt);
+		auto const grains = result["grains"].as<std::string>();
+		bool tune = result.count("tune") > 0;
+		if (tune && !batchName.empty()) {
+			// The runs of a batch share the cores, so the timings of one would include the load of the others
+			spdlog::warn("Tuning is disabled for a batch, which only uses the cached grain entries");
+			tune = false;
+		}
+		if (!grains.empty()) {
+			Pivot::GrainTuner::Configure(tune ? Pivot::GrainTuner::Mode::Tune : Pivot::GrainTuner::Mode::Cached, grains);
+		}
+		return std::tuple(driverOpt, simOpt, schedOpt, batchName);
 	} catch (cxxopts::exceptions::exception const &e) {
 		spdlog::critical("Failed to parse command line: {}", e.what());
 		std::exit(EXIT_FAILURE);
+	} catch (YAML::Exception const &e) {
+		spdlog::critical("Failed to parse command line: {}", e.what());
+		std::exit(EXIT_FAILURE);
 	}
 }
 
@@ -57,10 +94,18 @@ int main(int argc, char **argv) {
 	spdlog::set_level(spdlog::level::trace);
 	spdlog::flush_on(spdlog::level::trace);
 	// Main process
-	auto [driverOpt, simOpt] = ParseArgs(argc, argv);
-	auto driver     = std::make_unique<Pivot::Driver>(driverOpt);
-	auto simulation = Pivot::SimBuilder::Build(simOpt);
-	driver->Run(simulation.get());
+	auto [driverOpt, simOpt, schedOpt, batchName] = ParseArgs(argc, argv);
+	Pivot::Scheduler::Initialize(schedOpt);
+	Pivot::Scheduler::Execute([&] {
+		if (!batchName.empty()) {
+			Pivot::Batch(batchName, driverOpt.Dirname).Run();
+			return;
+		}
+		auto driver     = std::make_unique<Pivot::Driver>(driverOpt);
+		auto simulation = Pivot::SimBuilder::Build(simOpt);
+		driver->Run(simulation.get());
+	});
+	Pivot::GrainTuner::Save();
 
 	return EXIT_SUCCESS;
 }
@@ -1,6 +1,7 @@
 #include "Driver.h"
 
 #include "StopWatch.h"
+#include "Tracer.h"
 
 namespace Pivot {
 	template <typename Duration>
@@ -27,86 +28,205 @@ namespace Pivot {
 		m_BeginFrame { options.BeginFrame },
 		m_EndFrame { options.EndFrame },
 		m_SecondPerFrame { 1. / options.FrameRate },
-		m_CourantNumber { options.CourantNumber } {
+		m_TimeStep { options.TimeStep },
+		m_ArchiveName { options.ArchiveName },
+		m_ArchiveFields { options.ArchiveFields },
+		m_SnapshotEnabled { options.SnapshotEnabled },
+		m_TraceName { options.TraceName },
+		m_MetricsName { options.MetricsName },
+		m_Verbose { options.Verbose } {
 	}
 
-	void Driver::Run(Simulation *simulation) const {
+	DriverStats Driver::Run(Simulation *simulation) const {
 		using Clock = std::chrono::steady_clock;
 		auto const initTime = Clock::now();
+		std::unique_ptr<FrameWriter> archive;
+		std::unique_ptr<MetricsWriter> metrics;
+		TimeStepController controller(m_TimeStep);
+		DriverStats stats;
+		Tracer::SetEnabled(!m_TraceName.empty());
 
-		if (m_BeginFrame == 0) {
+		if (m_BeginFrame > 0 && !std::filesystem::is_directory(GetSnapshotDirname(m_BeginFrame - 1))) {
+			spdlog::critical("Failed to restart because the snapshot of Frame {} is missing", m_BeginFrame - 1);
+			std::exit(EXIT_FAILURE);
+		}
+		if (m_Verbose) {
 			fmt::print(fmt::fg(fmt::color::yellow_green), "[Initialize] ");
-			{ // Initialize simulation
-				auto sw = StopWatch("init.");
-				simulation->Initialize();
-				fmt::print("    ... {:>8.3f}s used\n", sw.Stop());
+		}
+		{ // Initialize simulation
+			auto sw = StopWatch("init.");
+			simulation->Initialize();
+			if (m_BeginFrame > 0) {
+				simulation->LoadSnapshot(GetSnapshotDirname(m_BeginFrame - 1));
 			}
-			if (std::filesystem::is_directory(m_Dirname)) {
-				spdlog::info("Output to the existing directory \"{}\"", m_Dirname.string());
-			} else {
-				std::filesystem::create_directories(m_Dirname);
-				spdlog::info("Output to a new directory \"{}\"", m_Dirname.string());
+			auto const seconds = sw.Stop();
+			if (m_Verbose) {
+				fmt::print("    ... {:>8.3f}s used\n", seconds);
 			}
-			std::filesystem::create_directory(m_Dirname);
-			ExportAndSaveFrame(simulation, 0);
+		}
+		if (std::filesystem::is_directory(m_Dirname)) {
+			if (m_Verbose) spdlog::info("Output to the existing directory \"{}\"", m_Dirname.string());
 		} else {
-			return;
+			std::filesystem::create_directories(m_Dirname);
+			if (m_Verbose) spdlog::info("Output to a new directory \"{}\"", m_Dirname.string());
+		}
+		if (!m_ArchiveName.empty()) {
+			// A restart keeps the frames before it
+			archive = std::make_unique<FrameWriter>(m_Dirname / m_ArchiveName, m_BeginFrame);
+		}
+		if (!m_MetricsName.empty()) {
+			metrics = std::make_unique<MetricsWriter>(m_Dirname / m_MetricsName);
+		}
+		if (m_BeginFrame == 0) {
+			ExportAndSaveFrame(simulation, 0, archive.get());
 		}
 
 		// Initialize timing
 		auto const beginTime = Clock::now();
-		spdlog::info("Begin simulating (elapsed time: {})\n", DurationFormat(beginTime - initTime));
+		if (m_Verbose) spdlog::info("Begin simulating (elapsed time: {})\n", DurationFormat(beginTime - initTime));
 		auto lastTime = beginTime;
 		auto beginFrame = std::max(m_BeginFrame, 1U);
 		for (auto frame = beginFrame; frame < m_EndFrame; frame++) {
 			// Simulate
-			spdlog::info("Start to simulate Frame {}", frame);
-			AdvanceTimeBySteps(simulation, frame);
+			if (m_Verbose) spdlog::info("Start to simulate Frame {}", frame);
+			AdvanceTimeBySteps(simulation, frame, controller, metrics.get(), stats);
 			// Export and save files for the frame
-			ExportAndSaveFrame(simulation, frame);
+			ExportAndSaveFrame(simulation, frame, archive.get());
 			// Output timing
 			auto const currentTime = Clock::now();
+			stats.Seconds = std::chrono::duration<double>(currentTime - beginTime).count();
+			if (!m_Verbose) {
+				lastTime = currentTime;
+				continue;
+			}
 			auto const frameTime = currentTime - lastTime;
 			auto const totalTime = currentTime - initTime;
 			spdlog::info("Finish simulating Frame {} (elapsed time: {}/{})", frame, DurationFormat(frameTime), DurationFormat(totalTime));
 			auto const elapsedRatio = (m_EndFrame - beginFrame) / (frame - beginFrame + 1.);
 			auto const prediTime = (currentTime - beginTime) * elapsedRatio + (beginTime - initTime);
 			spdlog::info("Estimated total time: {}\n", DurationFormat(prediTime));
+			if (Tracer::IsEnabled()) {
+				Tracer::PrintSummary(fmt::format("Frame {} (ms)", frame));
+			}
 			lastTime = currentTime;
 		}
-		spdlog::info("Completed simulating! (elapsed time: {})", DurationFormat(lastTime - initTime));
-		StopWatch::PrintStats();
+		if (m_Verbose) {
+			spdlog::info("Completed simulating! (elapsed time: {})", DurationFormat(lastTime - initTime));
+			StopWatch::PrintStats();
+		}
+		if (Tracer::IsEnabled()) {
+			Tracer::WriteChromeTrace(m_Dirname / m_TraceName);
+			spdlog::info("Trace written to \"{}\"", (m_Dirname / m_TraceName).string());
+		}
+		return stats;
 	}
 
-	void Driver::ExportAndSaveFrame(Simulation *simulation, std::uint32_t frame) const {
-		spdlog::info("Export results of Frame {}", frame);
+	void Driver::ExportAndSaveFrame(Simulation *simulation, std::uint32_t frame, FrameWriter *archive) const {
+		if (m_Verbose) spdlog::info("Export results of Frame {}", frame);
+		Tracer::Scope trace("export");
 		{ // Export results
 			auto const filename = m_Dirname / (std::to_string(frame) + ".png");
 			simulation->Export(filename);
 		}
+		if (archive) { // Append the frame to the archive
+			archive->BeginFrame(frame, frame * m_SecondPerFrame);
+			simulation->Export(*archive, m_ArchiveFields);
+			archive->EndFrame();
+		}
+		if (m_SnapshotEnabled) { // Save a restart point
+			simulation->SaveSnapshot(GetSnapshotDirname(frame));
+		}
 	}
 
-	void Driver::AdvanceTimeBySteps(Simulation *simulation, std::uint32_t frame) const {
+	void Driver::AdvanceTimeBySteps(Simulation *simulation, std::uint32_t frame, TimeStepController &controller, MetricsWriter *metrics, DriverStats &stats) const {
 		auto const startTime = (frame - 1) * m_SecondPerFrame;
 		double time = 0;
 		bool done = (time >= m_SecondPerFrame);
-		while (!done) {
-			simulation->SetTime(startTime + time);			
+		int numRejected = 0;
+		for (std::uint32_t substep = 0; !done; ) {
+			simulation->SetTime(startTime + time);
 			// Calculate delta time
-			auto deltaTime = std::min(m_SecondPerFrame, simulation->GetCourantTimeStep() * m_CourantNumber);
+			auto const courantTimeStep = simulation->GetCourantTimeStep();
+			auto deltaTime = std::min(m_SecondPerFrame, controller.Propose(*simulation));
+			bool last = false;
 			if (time + deltaTime >= m_SecondPerFrame) {
 				deltaTime = m_SecondPerFrame - time;
-				done = true;
+				last = true;
 			} else if (time + 2 * deltaTime >= m_SecondPerFrame) {
 				deltaTime = (m_SecondPerFrame - time) * .5; 
 			}
-			fmt::print(fmt::fg(fmt::color::yellow_green), "[{:>6.0f} SPF] ", m_SecondPerFrame / deltaTime);
+			if (m_Verbose) {
+				fmt::print(fmt::fg(fmt::color::yellow_green), "[{:>6.0f} SPF] ", m_SecondPerFrame / deltaTime);
+			}
+			if (controller.IsRejectionEnabled()) {
+				simulation->SaveCheckpoint();
+			}
 			{ // Advance with timing
 				auto sw = StopWatch("alg.");
 				simulation->Advance(deltaTime);
-				fmt::print("    ... {:>8.3f}s used\n", sw.Stop());
+				auto const seconds = sw.Stop();
+				if (!controller.Accept(deltaTime, courantTimeStep, simulation->GetCourantTimeStep())) {
+					if (m_Verbose) {
+						fmt::print("rejected (error {:.2e} cells) ... {:>8.3f}s used\n", controller.GetError(), seconds);
+					}
+					simulation->RestoreCheckpoint();
+					numRejected++;
+					stats.NumRejected++;
+					continue;
+				}
+				if (m_Verbose) {
+					auto const &substepStats = simulation->GetMetrics();
+					fmt::print("volume {:.3e} ({:+.2e}) {:<9} ... {:>8.3f}s used\n", substepStats.Volume, substepStats.VolumeError, TimeStepController::NameOf(controller.GetLimit()), seconds);
+				}
+			}
+			if (metrics) { // Record solver statistics
+				auto substepStats = simulation->GetMetrics();
+				substepStats.Frame = frame;
+				substepStats.Substep = substep;
+				substepStats.Time = startTime + time;
+				substepStats.CourantNumber = deltaTime / courantTimeStep;
+				substepStats.NumRejected = numRejected;
+				substepStats.TimeStepError = controller.GetError();
+				metrics->Write(substepStats);
 			}
 			time += deltaTime;
+			done = last;
+			numRejected = 0;
+			substep++;
+			stats.NumSubsteps++;
 		}
 	}
+
+	std::optional<FrameArchive::Encoding> ParseFieldEncoding(std::string_view name) {
+		static std::unordered_map<std::string, std::optional<FrameArchive::Encoding>> const s_EncodingFromName = {
+			{ "none"     , std::nullopt                     },
+			{ "raw"      , FrameArchive::Encoding::Raw       },
+			{ "quantized", FrameArchive::Encoding::Quantized },
+		};
+		if (auto iter = s_EncodingFromName.find(std::string(name)); iter != s_EncodingFromName.end()) {
+			return iter->second;
+		} else {
+			spdlog::critical("Failed to parse field encoding name");
+			std::exit(EXIT_FAILURE);
+		}
+	}
+
+	void ParseDriverOptions(YAML::Node const &node, DriverCreateOptions &options) {
+		if (!node) return;
+		auto const assign = [&]<typename Type>(char const *key, Type &value) {
+			if (node[key]) value = node[key].as<Type>();
+		};
+		assign("begin", options.BeginFrame);
+		assign("end", options.EndFrame);
+		assign("rate", options.FrameRate);
+		assign("cfl", options.TimeStep.CourantNumber);
+		assign("capillary", options.TimeStep.CapillaryFactor);
+		assign("magnetic-dt", options.TimeStep.MagneticFactor);
+		assign("tolerance", options.TimeStep.ErrorTolerance);
+		assign("archive", options.ArchiveName);
+		if (node["fields"]) options.ArchiveFields = ParseFieldEncoding(node["fields"].as<std::string>());
+		assign("snapshot", options.SnapshotEnabled);
+		assign("trace", options.TraceName);
+		assign("metrics", options.MetricsName);
+	}
 }
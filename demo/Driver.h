@@ -1,31 +1,55 @@
 #pragma once
 
-#include "Simulation.h"
+#include "TimeStepController.h"
 
 namespace Pivot {
 	struct DriverCreateOptions {
-		std::filesystem::path Dirname;
-		std::uint32_t         BeginFrame    = 0;
-		std::uint32_t         EndFrame;
-		double                FrameRate     = 25;
-		double                CourantNumber = 1;
+		std::filesystem::path                 Dirname;
+		std::uint32_t                         BeginFrame    = 0;
+		std::uint32_t                         EndFrame      = 0; // required
+		double                                FrameRate     = 0; // required
+		TimeStepOptions                       TimeStep {};
+		std::string                           ArchiveName {};   // empty to disable the frame archive
+		std::optional<FrameArchive::Encoding> ArchiveFields {}; // no fields are archived if empty
+		bool                                  SnapshotEnabled = false;
+		std::string                           TraceName {};     // empty to disable tracing
+		std::string                           MetricsName {};   // empty to disable per-substep metrics
+		bool                                  Verbose = true; // print the progress of every frame and substep
+	};
+
+	struct DriverStats {
+		std::uint64_t NumSubsteps = 0; // accepted ones
+		std::uint64_t NumRejected = 0;
+		double        Seconds     = 0; // wall time of simulating the frames
 	};
 
 	class Driver {
 	public:
 		explicit Driver(DriverCreateOptions const &options);
 
-		void Run(Simulation *simulation) const;
+		DriverStats Run(Simulation *simulation) const;
 
 	private:
-		void ExportAndSaveFrame(Simulation *simulation, std::uint32_t frame) const;
-		void AdvanceTimeBySteps(Simulation *simulation, std::uint32_t frame) const;
+		std::filesystem::path GetSnapshotDirname(std::uint32_t frame) const { return m_Dirname / "snapshots" / std::to_string(frame); }
+
+		void ExportAndSaveFrame(Simulation *simulation, std::uint32_t frame, FrameWriter *archive) const;
+		void AdvanceTimeBySteps(Simulation *simulation, std::uint32_t frame, TimeStepController &controller, MetricsWriter *metrics, DriverStats &stats) const;
 
 	private:
-		std::filesystem::path m_Dirname;
-		std::uint32_t         m_BeginFrame;
-		std::uint32_t         m_EndFrame;
-		double                m_SecondPerFrame;
-		double                m_CourantNumber;
+		std::filesystem::path                 m_Dirname;
+		std::uint32_t                         m_BeginFrame;
+		std::uint32_t                         m_EndFrame;
+		double                                m_SecondPerFrame;
+		TimeStepOptions                       m_TimeStep;
+		std::string                           m_ArchiveName;
+		std::optional<FrameArchive::Encoding> m_ArchiveFields;
+		bool                                  m_SnapshotEnabled;
+		std::string                           m_TraceName;
+		std::string                           m_MetricsName;
+		bool                                  m_Verbose;
 	};
+
+	std::optional<FrameArchive::Encoding> ParseFieldEncoding(std::string_view name);
+	// Overwrites the options given by the keys of node, named as the command line options of demo.
+	void ParseDriverOptions(YAML::Node const &node, DriverCreateOptions &options);
 }
@@ -5,12 +5,37 @@
 namespace Pivot {
 std::unique_ptr<Simulation> SimBuilder::Build(SimBuildOptions const &options) {
     std::unique_ptr<Simulation> simulation;
-    switch (options.Scene) {
-    case Simulation::Scene::Box:
-        simulation = BuildBox(options);
-        break;
+    if (!options.Config.empty()) {
+        simulation = BuildFromConfig(options);
+    } else {
+        switch (options.Scene) {
+        case Simulation::Scene::Falling:
+            simulation = BuildFalling(options);
+            break;
+        case Simulation::Scene::BigBall:
+            simulation = BuildBigBall(options);
+            break;
+        case Simulation::Scene::Slope:
+            simulation = BuildSlope(options);
+            break;
+        case Simulation::Scene::Droplet:
+            simulation = BuildDroplet(options);
+            break;
+        case Simulation::Scene::Box:
+            simulation = BuildBox(options);
+            break;
+        }
     }
     simulation->m_Scene = options.Scene;
+    if (options.Susceptibility) {
+        simulation->m_Magnetic.SetSusceptibility(*options.Susceptibility);
+    }
+    if (options.ExternalField) {
+        simulation->m_Magnetic.SetExternalField(*options.ExternalField);
+    }
+    if (options.SurfaceTension) {
+        simulation->m_SurfaceTensionCoeff = *options.SurfaceTension;
+    }
     return simulation;
 }
 
@@ -30,4 +55,363 @@ SimBuilder::BuildBox(SimBuildOptions const &options) {
                ImplicitBox(center - halfLength, halfLength * 2));
     return sim;
 }
+
+// The presets below share the square domain of the box, with solids added to
+// the collider by CSG before it is finished. Their interfaces range from long
+// and thin (magnetic solve bound) to short around a large area (pressure solve
+// bound).
+std::unique_ptr<Simulation>
+SimBuilder::CreateSquare(SimBuildOptions const &options) {
+    constexpr double length = .15;
+    constexpr int bw = 2;
+    int const scale = options.Scale < 0 ? 128 : options.Scale;
+    StaggeredGrid sgrid(bw, length / (scale - bw * 2),
+                        Vector2i(1, 1) * scale);
+    auto sim = std::make_unique<Simulation>(sgrid);
+    sim->m_GravityEnabled = true;
+    sim->m_SurfaceTensionEnabled = true;
+    sim->m_MagneticEnabled = true;
+    return sim;
+}
+
+std::unique_ptr<Simulation>
+SimBuilder::BuildFalling(SimBuildOptions const &options) {
+    // A drop falls into a pool and onto a submerged ball
+    auto sim = CreateSquare(options);
+    double const length = sim->m_SGrid.GetDomainLengths().x();
+    CSG::Union(sim->m_LevelSet,
+               ImplicitBox(Vector2d(-1, -.5) * length,
+                           Vector2d(2, .25) * length));
+    CSG::Union(sim->m_LevelSet,
+               ImplicitSphere(Vector2d(0, .25) * length, .08 * length));
+    ImplicitSphere const ball(Vector2d(0, -.5) * length, .15 * length);
+    CSG::Union(sim->m_Collider.LevelSet, ball);
+    CSG::Except(sim->m_LevelSet, ball);
+    return sim;
+}
+
+std::unique_ptr<Simulation>
+SimBuilder::BuildBigBall(SimBuildOptions const &options) {
+    // A ball filling most of the domain settles in a bowl
+    auto sim = CreateSquare(options);
+    double const length = sim->m_SGrid.GetDomainLengths().x();
+    CSG::Union(sim->m_LevelSet,
+               ImplicitSphere(Vector2d(0, -.08) * length, .3 * length));
+    GridData<double> bowl(sim->m_Collider.LevelSet.GetGrid(),
+                          -std::numeric_limits<double>::infinity());
+    CSG::Intersect(bowl, ImplicitPlane(Vector2d(0, -.25) * length,
+                                       Vector2d(0, 1)));
+    CSG::Except(bowl, ImplicitSphere(Vector2d(0, -.08) * length,
+                                     .32 * length));
+    CSG::Union(sim->m_Collider.LevelSet, bowl);
+    return sim;
+}
+
+std::unique_ptr<Simulation>
+SimBuilder::BuildSlope(SimBuildOptions const &options) {
+    // A drop slides down an inclined floor
+    auto sim = CreateSquare(options);
+    double const length = sim->m_SGrid.GetDomainLengths().x();
+    Vector2d const normal = Vector2d(-.5, 1).normalized();
+    Vector2d const onSlope = Vector2d(0, -.2) * length;
+    CSG::Union(sim->m_Collider.LevelSet, ImplicitPlane(onSlope, normal));
+    Vector2d const dropCenter =
+        onSlope + Vector2d(-.25, -.125) * length + normal * .1 * length;
+    CSG::Union(sim->m_LevelSet, ImplicitSphere(dropCenter, .08 * length));
+    return sim;
+}
+
+std::unique_ptr<Simulation>
+SimBuilder::BuildDroplet(SimBuildOptions const &options) {
+    // A flat droplet spreads over an elliptic bump on the floor
+    auto sim = CreateSquare(options);
+    double const length = sim->m_SGrid.GetDomainLengths().x();
+    CSG::Union(sim->m_Collider.LevelSet,
+               ImplicitEllipsoid(Vector2d(0, -.5) * length,
+                                 Vector2d(.25, .1) * length));
+    CSG::Union(sim->m_LevelSet,
+               ImplicitEllipsoid(Vector2d(0, -.34) * length,
+                                 Vector2d(.12, .05) * length));
+    return sim;
+}
+
+template <typename Type>
+static void Assign(YAML::Node const &node, char const *key, Type &value) {
+    if (node && node[key]) {
+        value = node[key].as<Type>();
+    }
+}
+
+// A feature is switched by true or false, or enabled by giving its parameters
+static bool IsEnabled(YAML::Node const &node) {
+    bool enabled;
+    return !YAML::convert<bool>::decode(node, enabled) || enabled;
+}
+
+static bool HasParams(YAML::Node const &node) {
+    bool enabled;
+    return node && !YAML::convert<bool>::decode(node, enabled);
+}
+
+static std::unique_ptr<Surface> ParseSurface(YAML::Node const &node) {
+    auto const shape = node["shape"].as<std::string>();
+    if (shape == "box") {
+        return std::make_unique<ImplicitBox>(node["min"].as<Vector2d>(),
+                                             node["lengths"].as<Vector2d>());
+    } else if (shape == "sphere") {
+        return std::make_unique<ImplicitSphere>(node["center"].as<Vector2d>(),
+                                                node["radius"].as<double>());
+    } else if (shape == "plane") {
+        return std::make_unique<ImplicitPlane>(node["position"].as<Vector2d>(),
+                                               node["normal"].as<Vector2d>());
+    } else if (shape == "ellipsoid") {
+        return std::make_unique<ImplicitEllipsoid>(
+            node["center"].as<Vector2d>(), node["semi-axes"].as<Vector2d>());
+    } else {
+        spdlog::critical("Failed to parse shape \"{}\"", shape);
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+static void ApplyOperation(GridData<double> &levelSet,
+                           YAML::Node const &node) {
+    auto const surface = ParseSurface(node);
+    auto const op = node["op"].as<std::string>("union");
+    if (op == "union") {
+        CSG::Union(levelSet, *surface);
+    } else if (op == "intersect") {
+        CSG::Intersect(levelSet, *surface);
+    } else if (op == "except") {
+        CSG::Except(levelSet, *surface);
+    } else {
+        spdlog::critical("Failed to parse CSG operation \"{}\"", op);
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+// Returns the box bounding the shape, which a moving shape needs
+static std::pair<Vector2d, Vector2d> CalcBounds(YAML::Node const &node) {
+    auto const shape = node["shape"].as<std::string>();
+    if (shape == "box") {
+        Vector2d const min = node["min"].as<Vector2d>();
+        return {min, min + node["lengths"].as<Vector2d>()};
+    } else if (shape == "sphere") {
+        Vector2d const center = node["center"].as<Vector2d>();
+        double const radius = node["radius"].as<double>();
+        return {center.array() - radius, center.array() + radius};
+    } else if (shape == "ellipsoid") {
+        Vector2d const center = node["center"].as<Vector2d>();
+        Vector2d const semiAxes = node["semi-axes"].as<Vector2d>();
+        return {center - semiAxes, center + semiAxes};
+    } else {
+        spdlog::critical("Failed to move unbounded shape \"{}\"", shape);
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+// Applies the operations in order, where union adds the region of the shape
+static void ApplyCSG(GridData<double> &levelSet, YAML::Node const &ops) {
+    for (auto const &node : ops) {
+        ApplyOperation(levelSet, node);
+    }
+}
+
+// Like ApplyCSG, but the shapes given a velocity or an angular velocity are
+// added as moving bodies, rotating about their pivot or the origin
+static void ApplyCSG(Collider &collider, YAML::Node const &ops) {
+    for (auto const &node : ops) {
+        if (!node["velocity"] && !node["angular-velocity"]) {
+            ApplyOperation(collider.LevelSet, node);
+            continue;
+        }
+        if (node["op"].as<std::string>("union") != "union") {
+            spdlog::critical("Failed to move a shape not added by union");
+            std::exit(EXIT_FAILURE);
+        }
+        Collider::Body body;
+        body.Shape = ParseSurface(node);
+        body.Pivot = node["pivot"].as<Vector2d>(Vector2d::Zero());
+        std::tie(body.BoundsMin, body.BoundsMax) = CalcBounds(node);
+        Assign(node, "velocity", body.LinearVelocity);
+        Assign(node, "angular-velocity", body.AngularVelocity);
+        collider.AddBody(std::move(body));
+    }
+}
+
+std::unique_ptr<Simulation>
+SimBuilder::BuildFromConfig(SimBuildOptions const &options) {
+    try {
+        YAML::Node const root = YAML::LoadFile(options.Config.string());
+
+        YAML::Node const domain = root["domain"];
+        double length = .15;
+        int bw = 2;
+        int scale = 128;
+        Vector2i ratio = Vector2i::Ones();
+        Vector2d center = Vector2d::Zero();
+        Assign(domain, "length", length);
+        Assign(domain, "border", bw);
+        Assign(domain, "scale", scale);
+        Assign(domain, "ratio", ratio);
+        Assign(domain, "center", center);
+        if (options.Scale >= 0) {
+            scale = options.Scale;
+        }
+        // The domain is length wide in the cells of a scale-wide grid
+        int const inner = scale - bw * 2;
+        StaggeredGrid sgrid(bw, length / inner,
+                            ratio * inner + Vector2i::Constant(bw * 2),
+                            center);
+        auto sim = std::make_unique<Simulation>(sgrid);
+        ApplyCSG(sim->m_LevelSet, root["liquid"]);
+        ApplyCSG(sim->m_Collider, root["solid"]);
+
+        // Missing sections and keys keep the defaults of Simulation
+        if (YAML::Node const physics = root["physics"]) {
+            Assign(physics, "density", sim->m_LiquidDensity);
+            if (auto const gravity = physics["gravity"]) {
+                sim->m_GravityEnabled = IsEnabled(gravity);
+                if (HasParams(gravity)) {
+                    sim->m_Gravity = gravity.as<Vector2d>();
+                }
+            }
+            if (auto const tension = physics["surface-tension"]) {
+                sim->m_SurfaceTensionEnabled = IsEnabled(tension);
+                if (HasParams(tension)) {
+                    sim->m_SurfaceTensionCoeff = tension.as<double>();
+                }
+            }
+            if (auto const magnetic = physics["magnetic"]) {
+                sim->m_MagneticEnabled = IsEnabled(magnetic);
+                if (HasParams(magnetic)) {
+                    if (magnetic["chi"]) {
+                        sim->m_Magnetic.SetSusceptibility(
+                            magnetic["chi"].as<double>());
+                    }
+                    Assign(magnetic, "hext", sim->m_Magnetic.m_Hext);
+                }
+            }
+        }
+        if (YAML::Node const solver = root["solver"]) {
+            auto const advection =
+                solver["advection"].as<std::string>("semi-lagrangian");
+            if (advection == "semi-lagrangian") {
+                sim->m_AdvectionScheme = Advection::Scheme::SemiLagrangian;
+            } else if (advection == "maccormack") {
+                sim->m_AdvectionScheme = Advection::Scheme::MacCormack;
+            } else if (advection == "bfecc") {
+                sim->m_AdvectionScheme = Advection::Scheme::BFECC;
+            } else {
+                spdlog::critical("Failed to parse advection \"{}\"",
+                                 advection);
+                std::exit(EXIT_FAILURE);
+            }
+            Assign(solver, "reinit-steps", sim->m_ReinitSteps);
+            auto const reinit =
+                solver["reinit-method"].as<std::string>("fmm");
+            if (reinit == "fmm") {
+                sim->m_ReinitMethod = Reinitialization::Method::FastMarching;
+            } else if (reinit == "geometric") {
+                sim->m_ReinitMethod = Reinitialization::Method::Geometric;
+            } else {
+                spdlog::critical("Failed to parse reinitialization \"{}\"",
+                                 reinit);
+                std::exit(EXIT_FAILURE);
+            }
+            Assign(solver, "extrapolation-steps", sim->m_ExtrapolationSteps);
+            if (auto const pressure = solver["pressure"]) {
+                if (pressure["tolerance"]) {
+                    sim->m_Pressure.SetTolerance(
+                        pressure["tolerance"].as<double>());
+                }
+                if (pressure["max-iterations"]) {
+                    sim->m_Pressure.SetMaxIterations(
+                        pressure["max-iterations"].as<int>());
+                }
+            }
+            if (auto const magnetic = solver["magnetic"]) {
+                auto &mag = sim->m_Magnetic;
+                auto const method = magnetic["method"].as<std::string>("fpi");
+                if (method == "fpi") {
+                    mag.m_Method = Magnetic::Method::FPI;
+                } else if (method == "mc") {
+                    mag.m_Method = Magnetic::Method::MC;
+                } else if (method == "panel") {
+                    mag.m_Method = Magnetic::Method::Panel;
+                } else {
+                    spdlog::critical("Failed to parse magnetic solver \"{}\"",
+                                     method);
+                    std::exit(EXIT_FAILURE);
+                }
+                Assign(magnetic, "iterations", mag.m_NumIteration);
+                Assign(magnetic, "epsilon", mag.m_EpsFPI);
+                Assign(magnetic, "threshold", mag.m_StopThres);
+                Assign(magnetic, "samples", mag.m_NumSample);
+                Assign(magnetic, "roulette", mag.m_RussianRoulette);
+                Assign(magnetic, "mc-epsilon", mag.m_EpsMC);
+                Assign(magnetic, "seed", mag.m_Seed);
+                Assign(magnetic, "reuse-walks", mag.m_ReuseWalks);
+                Assign(magnetic, "walks", mag.m_NumWalks);
+                Assign(magnetic, "resample-spacing", mag.m_ResampleSpacing);
+                Assign(magnetic, "resample-angle", mag.m_ResampleAngle);
+                Assign(magnetic, "resample-check", mag.m_CheckResampling);
+            }
+        }
+        return sim;
+    } catch (YAML::Exception const &e) {
+        spdlog::critical("Failed to load scene \"{}\": {}",
+                         options.Config.string(), e.what());
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+Simulation::Scene ParseSceneName(std::string_view name) {
+    static std::unordered_map<std::string, Simulation::Scene> const
+        s_SceneFromName = {
+            {"falling", Simulation::Scene::Falling},
+            {"bigball", Simulation::Scene::BigBall},
+            {"slope", Simulation::Scene::Slope},
+            {"droplet", Simulation::Scene::Droplet},
+            {"box", Simulation::Scene::Box},
+        };
+    if (auto iter = s_SceneFromName.find(std::string(name));
+        iter != s_SceneFromName.end()) {
+        return iter->second;
+    } else {
+        spdlog::critical("Failed to parse test case name");
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+void ParseSimBuildOptions(YAML::Node const &node, SimBuildOptions &options) {
+    if (!node) {
+        return;
+    }
+    if (node["test"]) {
+        options.Scene = ParseSceneName(node["test"].as<std::string>());
+    }
+    if (node["config"]) {
+        options.Config = node["config"].as<std::string>();
+    }
+    Assign(node, "scale", options.Scale);
+    if (node["chi"]) {
+        options.Susceptibility = node["chi"].as<double>();
+    }
+    if (node["hext"]) {
+        options.ExternalField = node["hext"].as<Vector2d>();
+    }
+    if (node["surface-tension"]) {
+        options.SurfaceTension = node["surface-tension"].as<double>();
+    }
+}
+
+YAML::Node LoadSceneOutput(std::filesystem::path const &config) {
+    try {
+        return YAML::LoadFile(config.string())["output"];
+    } catch (YAML::Exception const &e) {
+        spdlog::critical("Failed to load scene \"{}\": {}", config.string(),
+                         e.what());
+        std::exit(EXIT_FAILURE);
+    }
+}
 } // namespace Pivot
@@ -4,15 +4,33 @@
 
 namespace Pivot {
 	struct SimBuildOptions {
-		Simulation::Scene Scene;
-		int               Scale;
+		Simulation::Scene       Scene = Simulation::Scene::Box;
+		int                     Scale = -1;
+		std::filesystem::path   Config {}; // scene file used in place of the preset scene if not empty
+		// Overrides of the physical parameters of the scene
+		std::optional<double>   Susceptibility {};
+		std::optional<Vector2d> ExternalField {};
+		std::optional<double>   SurfaceTension {};
 	};
 
 	class SimBuilder {
 	public:
 		static std::unique_ptr<Simulation> Build(SimBuildOptions const &options);
-	
+
 	private:
-		static std::unique_ptr<Simulation> BuildBox(SimBuildOptions const &options);
+		static std::unique_ptr<Simulation> CreateSquare(SimBuildOptions const &options);
+
+		static std::unique_ptr<Simulation> BuildFalling(SimBuildOptions const &options);
+		static std::unique_ptr<Simulation> BuildBigBall(SimBuildOptions const &options);
+		static std::unique_ptr<Simulation> BuildSlope  (SimBuildOptions const &options);
+		static std::unique_ptr<Simulation> BuildDroplet(SimBuildOptions const &options);
+		static std::unique_ptr<Simulation> BuildBox    (SimBuildOptions const &options);
+		static std::unique_ptr<Simulation> BuildFromConfig(SimBuildOptions const &options);
 	};
+
+	Simulation::Scene ParseSceneName(std::string_view name);
+	// Overwrites the options given by the flat keys of node: test, config, scale, chi, hext and surface-tension.
+	void ParseSimBuildOptions(YAML::Node const &node, SimBuildOptions &options);
+	// Returns the output section of a scene file, which holds driver options.
+	YAML::Node LoadSceneOutput(std::filesystem::path const &config);
 }
@@ -8,7 +8,6 @@ add_requires("cxxopts v3.1.1")
 add_requires("eigen")
 add_requires("spdlog", { configs = { fmt_external = true } })
 add_requires("tbb")
-add_requires("openmp")
 add_requires("stb")
 add_requires("yaml-cpp 0.7.0")
 
@@ -19,7 +18,6 @@ target("demo")
     add_packages("eigen" )
     add_packages("spdlog")
     add_packages("tbb")
-    add_packages("openmp")
     add_packages("stb")
     add_packages("yaml-cpp")
 
@@ -29,3 +27,23 @@ target("demo")
     add_headerfiles("demo/**.h")
     add_files("demo/**.cpp")
     add_includedirs("MC-style-vol-eval")
+
+target("bench")
+    set_kind("binary")
+    add_packages("amgcl")
+    add_packages("cxxopts")
+    add_packages("eigen" )
+    add_packages("spdlog")
+    add_packages("tbb")
+    add_packages("stb")
+    add_packages("yaml-cpp")
+
+    add_includedirs("core")
+    add_headerfiles("core/**.h")
+    add_files("core/**.cpp")
+    add_includedirs("demo")
+    add_headerfiles("demo/SimBuilder.h")
+    add_files("demo/SimBuilder.cpp")
+    add_headerfiles("bench/**.h")
+    add_files("bench/**.cpp")
+    add_includedirs("MC-style-vol-eval")